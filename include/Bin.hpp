@@ -8,7 +8,7 @@
 template <class T>
 class Bin{
 
-  std::vector<Segment<T>> edges;
+  SmallVector<Segment<T>,4> edges;//up to 4 edges are stored inline, so that copying a bin does not allocate
   
 public:
   Bin() = default;
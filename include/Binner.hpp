@@ -20,6 +20,7 @@ public:
   Binner(Iterator beginAxis, Iterator endAxis);
   Binner(std::initializer_list<Axis<T>> axes);
   Binner(unsigned numberOfDivisions, const T& lowEdge, const T& upEdge);
+  const std::vector<Axis<T>>& getAxes() const;
   const std::vector<Bin<T>>& getBins() const;
   const std::vector<Bin<T>>& generateBinning();
   template <class Iterator>
@@ -104,6 +105,13 @@ Binner<T>::Binner(unsigned numberOfDivisions, const T& lowEdge, const T& upEdge)
 
 }
 
+template <class T>
+const std::vector<Axis<T>>& Binner<T>::getAxes() const{
+  
+  return axes;
+
+}
+
 template <class T>
 const std::vector<Bin<T>>& Binner<T>::getBins() const{
   
@@ -0,0 +1,414 @@
+#ifndef BINNING_H
+#define BINNING_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include "Axis.hpp"
+#include "Bin.hpp"
+#include "Tracer.hpp"
+
+template <class T>
+class Binning{//locates the channel containing a point with per-axis index arithmetic instead of scanning all the bins
+
+  std::vector<std::vector<T>> edges;//sorted edges along each axis
+  std::vector<T> spacings;//spacing of the uniform axes, T{} for variable axes
+  std::vector<std::size_t> multiplier;//to compute the global index of a cell from its per-axis indices (the first multiplier is 1), empty if the grid is too large
+  std::vector<Bin<T>> channels;//channels ordered by the first cell they cover
+  std::vector<unsigned> channelIndices;//index of the channel covering each cell, channels.size() if no channel covers it
+  static constexpr std::size_t maxNumberOfCells = std::size_t(1) << 26;//the grid stores one index per cell, irregular sets of channels can have a huge number of cells
+  void prepareAxes();
+  void buildGrid();//one channel per cell, following the cell ordering
+  std::size_t getCellIndex(const std::vector<unsigned>& axisIndices) const;
+  template <class Iterator>
+  unsigned scanChannels(Iterator firstCoordinate) const;//locates the channel without the grid
+
+public:
+  Binning() = default;
+  template <class Iterator>
+  Binning(Iterator firstBin, Iterator lastBin);//bins of a different dimension than the first one, and bins overlapping a previous one, are ignored, the channels are scanned if their grid is too large
+  Binning(const std::vector<Axis<T>>& axes);//regular grid following the ordering of Binner
+  Binning(const std::vector<std::vector<T>>& edges);//regular grid with the given sorted edges along each axis, left empty if it is too large
+  unsigned getDimension() const;
+  unsigned getNumberOfDivisions(unsigned k) const;
+  std::size_t getNumberOfCells() const;//0 if the grid is too large to be stored
+  unsigned getNumberOfChannels() const;
+  const std::vector<T>& getEdges(unsigned k) const;
+  const Bin<T>& getChannel(unsigned channelIndex) const;
+  const std::vector<Bin<T>>& getChannels() const;
+  bool isUniform(unsigned k) const;
+  bool isRegular() const;//true if each cell is a channel and the channels follow the cell ordering
+  bool hasSameChannelsAs(const Binning<T>& other) const;//same edges for each channel, in the same order
+  unsigned getAxisIndex(unsigned k, const T& coordinate) const;//returns getNumberOfDivisions(k) if the coordinate is out of the axis
+  template <class Iterator>
+  unsigned findChannel(Iterator firstCoordinate, Iterator lastCoordinate) const;//returns getNumberOfChannels() if no channel contains the coordinates
+  unsigned findChannel(const Point<T>& point) const;
+  unsigned findChannel(const T& coordinate) const;//for 1-D binnings
+
+};
+
+template <class T>
+std::ostream& operator<<(std::ostream& output, const Binning<T>& binning){
+
+  for(const auto& channel : binning.getChannels()) output<<channel<<"\n";
+  return output;
+
+}
+
+template <class T>
+void Binning<T>::prepareAxes(){
+
+  spacings.assign(edges.size(), T{});
+  multiplier.assign(edges.size(), 1);
+
+  std::size_t numberOfCells = 1;
+  bool tooLarge = false;
+  for(unsigned k = 0; k < edges.size(); ++k){
+
+    multiplier.at(k) = numberOfCells;
+
+    unsigned numberOfDivisions = getNumberOfDivisions(k);
+    if(numberOfDivisions != 0 && numberOfCells > maxNumberOfCells / numberOfDivisions) tooLarge = true;//checked before multiplying, so the count cannot wrap
+    else numberOfCells *= numberOfDivisions;
+
+    if(numberOfDivisions == 0) continue;
+
+    T spacing = (edges.at(k).back() - edges.at(k).front())/numberOfDivisions;
+    bool uniform = spacing > T{};
+    for(unsigned i = 0; i < edges.at(k).size() && uniform; ++i)
+      uniform = std::abs(edges.at(k).at(i) - (edges.at(k).front() + i * spacing)) <= 1e-6 * spacing;//tolerate the rounding of the edges
+
+    if(uniform) spacings.at(k) = spacing;
+
+  }
+
+  if(tooLarge) multiplier.clear();
+
+}
+
+template <class T>
+std::size_t Binning<T>::getCellIndex(const std::vector<unsigned>& axisIndices) const{
+
+  std::size_t cellIndex{};
+  for(unsigned k = 0; k < axisIndices.size(); ++k) cellIndex += axisIndices.at(k) * multiplier.at(k);
+  return cellIndex;
+
+}
+
+template <class T>
+template <class Iterator>
+Binning<T>::Binning(Iterator firstBin, Iterator lastBin){
+
+  if(firstBin == lastBin || firstBin->getDimension() == 0) return;
+
+  unsigned dimension = firstBin->getDimension();
+  std::vector<Bin<T>> bins;
+  for(auto it = firstBin; it != lastBin; ++it) if(it->getDimension() == dimension) bins.emplace_back(*it);
+
+  edges.resize(dimension);
+  for(unsigned k = 0; k < dimension; ++k){
+
+    for(const auto& bin : bins){
+
+      edges.at(k).emplace_back(bin.getEdge(k).getLowEdge());
+      edges.at(k).emplace_back(bin.getEdge(k).getUpEdge());
+
+    }
+
+    std::sort(edges.at(k).begin(), edges.at(k).end());
+    edges.at(k).erase(std::unique(edges.at(k).begin(), edges.at(k).end()), edges.at(k).end());
+
+  }
+
+  prepareAxes();
+
+  std::vector<std::vector<unsigned>> lowIndices, upIndices;//range of cells covered by each bin along each axis
+  for(const auto& bin : bins){
+
+    lowIndices.emplace_back();
+    upIndices.emplace_back();
+    for(unsigned k = 0; k < dimension; ++k){
+
+      lowIndices.back().emplace_back(std::lower_bound(edges.at(k).begin(), edges.at(k).end(), bin.getEdge(k).getLowEdge()) - edges.at(k).begin());
+      upIndices.back().emplace_back(std::lower_bound(edges.at(k).begin(), edges.at(k).end(), bin.getEdge(k).getUpEdge()) - edges.at(k).begin());
+
+    }
+
+  }
+
+  std::vector<unsigned> order(bins.size());
+  for(unsigned k = 0; k < order.size(); ++k) order.at(k) = k;
+  std::stable_sort(order.begin(), order.end(), [&](unsigned i, unsigned j){//by the index of their first cell, compared axis by axis from the last one so that it is never computed
+
+    for(unsigned k = dimension; k-- > 0;) if(lowIndices.at(i).at(k) != lowIndices.at(j).at(k)) return lowIndices.at(i).at(k) < lowIndices.at(j).at(k);
+    return false;
+
+  });//a complete grid of bins then follows the cell ordering
+
+  bool gridded = !multiplier.empty();
+  if(gridded) channelIndices.assign(getNumberOfCells(), bins.size());//temporary 'no channel' value
+  else Tracer(Verbose::Warning)<<"The "<<bins.size()<<" bins span too many cells => Channels located by scanning them"<<std::endl;
+
+  std::vector<unsigned> orderedIndices;//indices of the bins actually kept as channels
+  std::vector<std::size_t> coveredCells;
+  for(auto binIndex : order){
+
+    std::vector<unsigned> axisIndices(lowIndices.at(binIndex));
+    bool empty = false;
+    for(unsigned k = 0; k < dimension; ++k) empty = empty || lowIndices.at(binIndex).at(k) >= upIndices.at(binIndex).at(k);
+    if(empty) continue;//skip degenerate bins
+
+    bool overlapping;
+    if(gridded){
+
+      coveredCells.clear();
+      while(axisIndices.back() < upIndices.at(binIndex).back()){//loop over all the cells covered by the bin
+
+        coveredCells.emplace_back(getCellIndex(axisIndices));
+
+        for(unsigned k = 0; k < dimension; ++k){//increment the per-axis indices like an odometer
+
+	  if(++axisIndices.at(k) < upIndices.at(binIndex).at(k) || k == dimension - 1) break;
+	  axisIndices.at(k) = lowIndices.at(binIndex).at(k);
+
+        }
+
+      }
+
+      overlapping = std::any_of(coveredCells.begin(), coveredCells.end(), [&](std::size_t cellIndex){return channelIndices.at(cellIndex) != bins.size();});
+
+    }
+    else overlapping = std::any_of(orderedIndices.begin(), orderedIndices.end(), [&](unsigned channelIndex){//the ranges of cells intersect along every axis
+
+      for(unsigned k = 0; k < dimension; ++k)
+        if(lowIndices.at(binIndex).at(k) >= upIndices.at(channelIndex).at(k) || lowIndices.at(channelIndex).at(k) >= upIndices.at(binIndex).at(k)) return false;
+      return true;
+
+    });
+
+    if(overlapping){//duplicate or partially overlapping bin: the cells keep the channel they already have
+
+      Tracer(Verbose::Warning)<<"Bin "<<bins.at(binIndex)<<" overlaps a previous bin => Bin ignored"<<std::endl;
+      continue;
+
+    }
+
+    for(auto cellIndex : coveredCells) channelIndices.at(cellIndex) = orderedIndices.size();
+    orderedIndices.emplace_back(binIndex);
+
+  }
+
+  for(auto binIndex : orderedIndices) channels.emplace_back(std::move(bins.at(binIndex)));
+  for(auto& channelIndex : channelIndices) if(channelIndex == bins.size()) channelIndex = channels.size();
+
+}
+
+template <class T>
+Binning<T>::Binning(const std::vector<Axis<T>>& axes){
+
+  for(const auto& axis : axes){
+
+    edges.emplace_back();
+    for(unsigned i = 0; i <= axis.getNumberOfDivisions(); ++i) edges.back().emplace_back(axis.getLowEdge() + i * axis.getSpacing());//same edges as the ones built by Binner
+
+  }
+
+  buildGrid();
+
+}
+
+template <class T>
+Binning<T>::Binning(const std::vector<std::vector<T>>& edges):edges(edges){
+
+  buildGrid();
+
+}
+
+template <class T>
+void Binning<T>::buildGrid(){
+
+  prepareAxes();
+  if(multiplier.empty() && !edges.empty()){//one channel per cell would not fit either
+
+    Tracer(Verbose::Error)<<"The regular grid has too many cells => Binning left empty"<<std::endl;
+    edges.clear();
+    spacings.clear();
+    return;
+
+  }
+
+  channels.resize(getNumberOfCells());
+  channelIndices.resize(getNumberOfCells());
+  for(std::size_t cellIndex = 0; cellIndex < getNumberOfCells(); ++cellIndex){
+
+    channelIndices.at(cellIndex) = cellIndex;
+    for(unsigned k = 0; k < edges.size(); ++k){
+
+      unsigned axisIndex = (cellIndex / multiplier.at(k)) % getNumberOfDivisions(k);
+      channels.at(cellIndex).emplaceBackEdge(edges.at(k).at(axisIndex), edges.at(k).at(axisIndex + 1));
+
+    }
+
+  }
+
+}
+
+template <class T>
+unsigned Binning<T>::getDimension() const{
+
+  return edges.size();
+
+}
+
+template <class T>
+unsigned Binning<T>::getNumberOfDivisions(unsigned k) const{
+
+  if(k < edges.size() && !edges.at(k).empty()) return edges.at(k).size() - 1;
+  else return 0;
+
+}
+
+template <class T>
+std::size_t Binning<T>::getNumberOfCells() const{
+
+  if(edges.empty() || multiplier.empty()) return 0;
+  else return multiplier.back() * getNumberOfDivisions(edges.size() - 1);//checked against overflows by prepareAxes
+
+}
+
+template <class T>
+unsigned Binning<T>::getNumberOfChannels() const{
+
+  return channels.size();
+
+}
+
+template <class T>
+const std::vector<T>& Binning<T>::getEdges(unsigned k) const{
+
+  return edges.at(k);
+
+}
+
+template <class T>
+const Bin<T>& Binning<T>::getChannel(unsigned channelIndex) const{
+
+  return channels.at(channelIndex);
+
+}
+
+template <class T>
+const std::vector<Bin<T>>& Binning<T>::getChannels() const{
+
+  return channels;
+
+}
+
+template <class T>
+bool Binning<T>::isUniform(unsigned k) const{
+
+  return k < spacings.size() && spacings.at(k) != T{};
+
+}
+
+template <class T>
+bool Binning<T>::isRegular() const{
+
+  if(channels.size() != channelIndices.size()) return false;
+  for(unsigned cellIndex = 0; cellIndex < channelIndices.size(); ++cellIndex)
+    if(channelIndices.at(cellIndex) != cellIndex) return false;
+
+  return true;
+
+}
+
+template <class T>
+bool Binning<T>::hasSameChannelsAs(const Binning<T>& other) const{
+
+  if(this == &other) return true;
+  if(channels.size() != other.channels.size() || getDimension() != other.getDimension()) return false;
+
+  return std::equal(channels.begin(), channels.end(), other.channels.begin(), [&](const Bin<T>& channel, const Bin<T>& otherChannel){
+
+    for(unsigned k = 0; k < getDimension(); ++k)
+      if(channel.getEdge(k).getLowEdge() != otherChannel.getEdge(k).getLowEdge() || channel.getEdge(k).getUpEdge() != otherChannel.getEdge(k).getUpEdge()) return false;
+    return true;
+
+  });
+
+}
+
+template <class T>
+unsigned Binning<T>::getAxisIndex(unsigned k, const T& coordinate) const{
+
+  unsigned numberOfDivisions = getNumberOfDivisions(k);
+  if(numberOfDivisions == 0) return 0;
+
+  const auto& axisEdges = edges.at(k);
+  if(!(coordinate >= axisEdges.front() && coordinate < axisEdges.back())) return numberOfDivisions;//also rejects NaN's
+
+  if(isUniform(k)){
+
+    unsigned index = std::min(static_cast<unsigned>((coordinate - axisEdges.front())/spacings.at(k)), numberOfDivisions - 1);
+    while(index > 0 && coordinate < axisEdges[index]) --index;//correct the rounding so as to agree with Segment::contains
+    while(index < numberOfDivisions - 1 && coordinate >= axisEdges[index + 1]) ++index;
+    return index;
+
+  }
+  else return std::upper_bound(axisEdges.begin(), axisEdges.end(), coordinate) - axisEdges.begin() - 1;
+
+}
+
+template <class T>
+template <class Iterator>
+unsigned Binning<T>::findChannel(Iterator firstCoordinate, Iterator lastCoordinate) const{
+
+  if(channels.empty()) return getNumberOfChannels();
+
+  bool gridded = !multiplier.empty();
+  std::size_t cellIndex{};
+  unsigned k{};
+  for(auto it = firstCoordinate; it != lastCoordinate && k < edges.size(); ++it, ++k){
+
+    unsigned axisIndex = getAxisIndex(k, *it);
+    if(axisIndex == getNumberOfDivisions(k)) return getNumberOfChannels();
+    if(gridded) cellIndex += axisIndex * multiplier[k];
+
+  }
+
+  if(k < edges.size()) return getNumberOfChannels();//not enough coordinates to locate the cell
+  else if(gridded) return channelIndices[cellIndex];
+  else return scanChannels(firstCoordinate);
+
+}
+
+template <class T>
+template <class Iterator>
+unsigned Binning<T>::scanChannels(Iterator firstCoordinate) const{
+
+  return std::find_if(channels.begin(), channels.end(), [&](const Bin<T>& channel){//the channels do not overlap, so at most one contains the coordinates
+
+    auto it = firstCoordinate;
+    for(unsigned k = 0; k < edges.size(); ++k, ++it) if(!channel.getEdge(k).contains(*it)) return false;
+    return true;
+
+  }) - channels.begin();
+
+}
+
+template <class T>
+unsigned Binning<T>::findChannel(const Point<T>& point) const{
+
+  return findChannel(point.begin(), point.end());
+
+}
+
+template <class T>
+unsigned Binning<T>::findChannel(const T& coordinate) const{
+
+  return findChannel(&coordinate, &coordinate + 1);
+
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+template <class T>
+class BoundedQueue{//queue between producer and consumer threads: push waits while the queue is full and pop while it is empty
+
+  std::deque<T> elements;
+  unsigned capacity;
+  bool closed;
+  std::mutex mutex;
+  std::condition_variable notFull;
+  std::condition_variable notEmpty;
+
+public:
+  BoundedQueue(unsigned capacity);
+  bool push(T element);//returns false if the queue has been closed, the element is then dropped
+  bool pop(T& element);//returns false once the queue is closed and empty
+  void close();//no element can be pushed afterwards, the remaining ones can still be popped
+
+};
+
+template <class T>
+BoundedQueue<T>::BoundedQueue(unsigned capacity):capacity(std::max(capacity, 1u)),closed(false){
+
+}
+
+template <class T>
+bool BoundedQueue<T>::push(T element){
+
+  std::unique_lock<std::mutex> lock(mutex);
+  notFull.wait(lock, [&](){return closed || elements.size() < capacity;});//back-pressure on the producer
+  if(closed) return false;
+
+  elements.emplace_back(std::move(element));
+  lock.unlock();
+  notEmpty.notify_one();
+  return true;
+
+}
+
+template <class T>
+bool BoundedQueue<T>::pop(T& element){
+
+  std::unique_lock<std::mutex> lock(mutex);
+  notEmpty.wait(lock, [&](){return closed || !elements.empty();});
+  if(elements.empty()) return false;
+
+  element = std::move(elements.front());
+  elements.pop_front();
+  lock.unlock();
+  notFull.notify_one();
+  return true;
+
+}
+
+template <class T>
+void BoundedQueue<T>::close(){
+
+  {
+
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+
+  }
+
+  notFull.notify_all();
+  notEmpty.notify_all();
+
+}
+
+#endif
@@ -70,6 +70,8 @@ namespace constants{
   void adaptUnits(double& runLenght, double& power1, double& power2);//convert values to days and GW
   double crossSection(double neutrinoEnergy);
   double oscillation(double neutrinoEnergy, double distance, double th13 = mixing::th13, double delta31 = squaredMass::delta31);//energy in MeV and distance in m
+  void crossSection(const double* neutrinoEnergies, double* crossSections, unsigned size);//array versions, vectorised when compiled with OpenMP SIMD support and without errno nor trapping math (see the Makefile)
+  void oscillation(const double* neutrinoEnergies, double* survivalProbabilities, unsigned size, double distance, double th13 = mixing::th13, double delta31 = squaredMass::delta31);
   
 }
 
@@ -0,0 +1,497 @@
+#ifndef CORRELATED_HISTOGRAM_H
+#define CORRELATED_HISTOGRAM_H
+
+#include <vector>
+#include <cmath>
+#include <string>
+#include <stdexcept>
+#include "Binning.hpp"
+#include "DenseHistogram.hpp"
+#include "Parallel.hpp"
+#include "Tracer.hpp"
+
+template <class T, class K>
+class CorrelatedHistogram{//dense histogram carrying the full covariance matrix of its channels, propagated as J.C.J^T instead of through the identifiers of Scalar
+
+  Binning<T> binning;
+  std::vector<K> values;//following the channel ordering of 'binning'
+  std::vector<K> covariance;//channels x channels, row by row
+  K& getCovarianceElement(unsigned i, unsigned j);
+  bool hasSameChannels(const CorrelatedHistogram<T,K>& other, const char* operation) const;
+
+public:
+  CorrelatedHistogram() = default;
+  CorrelatedHistogram(const Binning<T>& binning);
+  explicit CorrelatedHistogram(const DenseHistogram<T,Scalar<K>>& denseHistogram);//uncorrelated channels
+  explicit CorrelatedHistogram(const DenseHistogram<T,K>& denseHistogram);//Poisson variances, uncorrelated channels
+  CorrelatedHistogram<T,K>& operator+=(const CorrelatedHistogram<T,K>& other);//the histograms are independent from each other
+  CorrelatedHistogram<T,K>& operator-=(const CorrelatedHistogram<T,K>& other);
+  CorrelatedHistogram<T,K>& operator*=(const K& factor);
+  CorrelatedHistogram<T,K>& operator/=(const CorrelatedHistogram<T,K>& divider);//channel by channel, channels divided by zero are left unchanged
+  CorrelatedHistogram<T,K>& normalise();//correlates the channels through the total counts
+  CorrelatedHistogram<T,K>& scaleCountsTo(const K& newNorm);
+  CorrelatedHistogram<T,K>& integrateDimensions(std::vector<unsigned> dimensionsToRemove);//for regular binnings, like DenseHistogram
+  CorrelatedHistogram<T,K>& transform(const Binning<T>& newBinning, std::vector<K> newValues, const std::vector<K>& jacobian);//general linearised propagation, the jacobian having one row of getNumberOfChannels() derivatives per new channel
+  const Binning<T>& getBinning() const;
+  unsigned getNumberOfChannels() const;
+  const std::vector<K>& getValues() const;
+  const std::vector<K>& getCovarianceMatrix() const;
+  K getValue(unsigned channelIndex) const;
+  K getVariance(unsigned channelIndex) const;
+  K getCovariance(unsigned channelIndex1, unsigned channelIndex2) const;
+  K getCorrelation(unsigned channelIndex1, unsigned channelIndex2) const;
+  Scalar<K> getCount(unsigned channelIndex) const;
+  K getTotalCounts() const;
+  K getChiSquare(const std::vector<K>& expectation) const;//(x-e)^T C^-1 (x-e) through a Cholesky decomposition of the covariance matrix
+  DenseHistogram<T,Scalar<K>> getDenseHistogram() const;//keeps the variances only
+  void setCount(unsigned channelIndex, const K& value, const K& variance);
+  void setCovariance(unsigned channelIndex1, unsigned channelIndex2, const K& covariance);
+
+};
+
+template <class T, class K>
+std::ostream& operator<<(std::ostream& output, const CorrelatedHistogram<T,K>& histogram){
+
+  for(unsigned k = 0; k < histogram.getNumberOfChannels(); ++k)
+    output<<histogram.getBinning().getChannel(k)<<std::setw(6)<<std::left<<" "<<"-->"<<std::setw(6)<<std::left<<" "<<std::setw(9)<<std::left<<histogram.getCount(k)<<"\n";
+  return output;
+
+}
+
+template <class T, class K>
+K& CorrelatedHistogram<T,K>::getCovarianceElement(unsigned i, unsigned j){
+
+  return covariance[i * values.size() + j];
+
+}
+
+template <class T, class K>
+bool CorrelatedHistogram<T,K>::hasSameChannels(const CorrelatedHistogram<T,K>& other, const char* operation) const{
+
+  if(binning.hasSameChannelsAs(other.binning)) return true;
+
+  Tracer(Verbose::Error)<<operation<<" correlated histograms with different channels => Histogram unchanged"<<std::endl;
+  return false;
+
+}
+
+template <class T, class K>
+CorrelatedHistogram<T,K>::CorrelatedHistogram(const Binning<T>& binning):binning(binning),values(binning.getNumberOfChannels(), K{}),covariance(values.size() * values.size(), K{}){
+
+}
+
+template <class T, class K>
+CorrelatedHistogram<T,K>::CorrelatedHistogram(const DenseHistogram<T,Scalar<K>>& denseHistogram):CorrelatedHistogram(denseHistogram.getBinning()){
+
+  const auto& counts = denseHistogram.getCounts();
+  for(unsigned k = 0; k < values.size(); ++k) setCount(k, counts.getValues()[k], counts.getVariances()[k]);
+
+}
+
+template <class T, class K>
+CorrelatedHistogram<T,K>::CorrelatedHistogram(const DenseHistogram<T,K>& denseHistogram):CorrelatedHistogram(denseHistogram.getBinning()){
+
+  for(unsigned k = 0; k < values.size(); ++k) setCount(k, denseHistogram.getCount(k), denseHistogram.getCount(k));
+
+}
+
+template <class T, class K>
+CorrelatedHistogram<T,K>& CorrelatedHistogram<T,K>::operator+=(const CorrelatedHistogram<T,K>& other){
+
+  if(!hasSameChannels(other, "Adding")) return *this;
+
+  for(unsigned k = 0; k < values.size(); ++k) values[k] += other.values[k];
+  for(unsigned k = 0; k < covariance.size(); ++k) covariance[k] += other.covariance[k];
+  return *this;
+
+}
+
+template <class T, class K>
+CorrelatedHistogram<T,K>& CorrelatedHistogram<T,K>::operator-=(const CorrelatedHistogram<T,K>& other){
+
+  if(!hasSameChannels(other, "Subtracting")) return *this;
+
+  for(unsigned k = 0; k < values.size(); ++k) values[k] -= other.values[k];
+  for(unsigned k = 0; k < covariance.size(); ++k) covariance[k] += other.covariance[k];//J = (I, -I)
+  return *this;
+
+}
+
+template <class T, class K>
+CorrelatedHistogram<T,K>& CorrelatedHistogram<T,K>::operator*=(const K& factor){
+
+  for(auto& value : values) value *= factor;
+  for(auto& element : covariance) element *= factor * factor;
+  return *this;
+
+}
+
+template <class T, class K>
+CorrelatedHistogram<T,K>& CorrelatedHistogram<T,K>::operator/=(const CorrelatedHistogram<T,K>& divider){
+
+  if(!hasSameChannels(divider, "Dividing")) return *this;
+
+  unsigned numberOfChannels = values.size();
+  std::vector<K> numeratorDerivatives(numberOfChannels), dividerDerivatives(numberOfChannels);//diagonal jacobians with respect to this and to divider
+  unsigned numberOfZeroDividers{};
+  for(unsigned k = 0; k < numberOfChannels; ++k){
+
+    if(divider.values[k] == K{}){
+
+      numeratorDerivatives[k] = 1;
+      ++numberOfZeroDividers;
+
+    }
+    else{
+
+      numeratorDerivatives[k] = 1 / divider.values[k];
+      dividerDerivatives[k] = - values[k] / (divider.values[k] * divider.values[k]);
+
+    }
+
+  }
+
+  parallel::forEachIndex(numberOfChannels, [&](unsigned i){
+
+    K* row = covariance.data() + i * numberOfChannels;
+    const K* dividerRow = divider.covariance.data() + i * numberOfChannels;
+    for(unsigned j = 0; j < numberOfChannels; ++j) row[j] = numeratorDerivatives[i] * row[j] * numeratorDerivatives[j] + dividerDerivatives[i] * dividerRow[j] * dividerDerivatives[j];
+
+  });
+
+  for(unsigned k = 0; k < numberOfChannels; ++k) values[k] *= numeratorDerivatives[k];
+  if(numberOfZeroDividers != 0) Tracer(Verbose::Warning)<<"Histogram division of "<<numberOfZeroDividers<<" channels by "<<K{}<<" not allowed!"<<std::endl;
+  return *this;
+
+}
+
+template <class T, class K>
+CorrelatedHistogram<T,K>& CorrelatedHistogram<T,K>::normalise(){
+
+  K totalCounts = getTotalCounts();
+  if(totalCounts == K{}){
+
+    Tracer(Verbose::Warning)<<"Histogram has no counts: already normalised!"<<std::endl;
+    return *this;
+
+  }
+
+  unsigned numberOfChannels = values.size();
+  std::vector<K> fractions(numberOfChannels), rowSums(numberOfChannels, K{});//J = (I - fractions.1^T)/totalCounts, so J.C.J^T only needs C.1 and 1^T.C.1
+  K totalCovariance{};
+  for(unsigned i = 0; i < numberOfChannels; ++i){
+
+    fractions[i] = values[i] / totalCounts;
+    for(unsigned j = 0; j < numberOfChannels; ++j) rowSums[i] += covariance[i * numberOfChannels + j];
+    totalCovariance += rowSums[i];
+
+  }
+
+  parallel::forEachIndex(numberOfChannels, [&](unsigned i){
+
+    K* row = covariance.data() + i * numberOfChannels;
+    for(unsigned j = 0; j < numberOfChannels; ++j) row[j] = (row[j] - fractions[i] * rowSums[j] - rowSums[i] * fractions[j] + fractions[i] * fractions[j] * totalCovariance) / (totalCounts * totalCounts);
+
+  });
+
+  values = std::move(fractions);
+  return *this;
+
+}
+
+template <class T, class K>
+CorrelatedHistogram<T,K>& CorrelatedHistogram<T,K>::scaleCountsTo(const K& newNorm){
+
+  if(getTotalCounts() != K{}) normalise() *= newNorm;
+  return *this;
+
+}
+
+template <class T, class K>
+CorrelatedHistogram<T,K>& CorrelatedHistogram<T,K>::integrateDimensions(std::vector<unsigned> dimensionsToRemove){
+
+  if(!binning.isRegular()){
+
+    Tracer(Verbose::Error)<<"Cannot integrate the dimensions of a correlated histogram whose channels do not form a regular grid => Histogram not integrated"<<std::endl;
+    return *this;
+
+  }
+
+  unsigned dimension = binning.getDimension();
+  std::vector<bool> removed(dimension, false);
+  for(auto dimensionToRemove : dimensionsToRemove) if(dimensionToRemove < dimension) removed[dimensionToRemove] = true;
+
+  std::vector<std::vector<T>> keptEdges;
+  std::vector<unsigned> strides(dimension, 0);
+  unsigned stride = 1;
+  for(unsigned k = 0; k < dimension; ++k){
+
+    if(removed[k]) continue;
+    keptEdges.emplace_back(binning.getEdges(k));
+    strides[k] = stride;
+    stride *= binning.getNumberOfDivisions(k);
+
+  }
+
+  if(keptEdges.empty()){
+
+    Tracer(Verbose::Warning)<<"Cannot integrate all the dimensions of a correlated histogram => Histogram not integrated"<<std::endl;
+    return *this;
+
+  }
+
+  unsigned numberOfChannels = values.size();
+  std::vector<unsigned> integratedIndices(numberOfChannels);//the jacobian has a single 1 per column, at the integrated channel of each cell
+  std::vector<unsigned> axisIndices(dimension, 0);
+  unsigned integratedIndex{};
+  for(unsigned cellIndex = 0; cellIndex < numberOfChannels; ++cellIndex){
+
+    integratedIndices[cellIndex] = integratedIndex;
+    for(unsigned k = 0; k < dimension; ++k){
+
+      if(++axisIndices[k] < binning.getNumberOfDivisions(k)){
+
+        integratedIndex += strides[k];
+        break;
+
+      }
+
+      integratedIndex -= strides[k] * (axisIndices[k] - 1);
+      axisIndices[k] = 0;
+
+    }
+
+  }
+
+  Binning<T> integratedBinning(keptEdges);
+  unsigned numberOfIntegratedChannels = integratedBinning.getNumberOfChannels();
+  std::vector<K> integratedValues(numberOfIntegratedChannels, K{});
+  for(unsigned cellIndex = 0; cellIndex < numberOfChannels; ++cellIndex) integratedValues[integratedIndices[cellIndex]] += values[cellIndex];
+
+  std::vector<K> partialCovariance(numberOfChannels * numberOfIntegratedChannels, K{});//C.J^T, the rows being independent
+  parallel::forEachIndex(numberOfChannels, [&](unsigned i){
+
+    const K* row = covariance.data() + i * numberOfChannels;
+    K* partialRow = partialCovariance.data() + i * numberOfIntegratedChannels;
+    for(unsigned j = 0; j < numberOfChannels; ++j) partialRow[integratedIndices[j]] += row[j];
+
+  });
+
+  std::vector<K> integratedCovariance(numberOfIntegratedChannels * numberOfIntegratedChannels, K{});//J.(C.J^T)
+  for(unsigned i = 0; i < numberOfChannels; ++i){
+
+    const K* partialRow = partialCovariance.data() + i * numberOfIntegratedChannels;
+    K* integratedRow = integratedCovariance.data() + integratedIndices[i] * numberOfIntegratedChannels;
+    for(unsigned b = 0; b < numberOfIntegratedChannels; ++b) integratedRow[b] += partialRow[b];
+
+  }
+
+  binning = std::move(integratedBinning);
+  values = std::move(integratedValues);
+  covariance = std::move(integratedCovariance);
+  return *this;
+
+}
+
+template <class T, class K>
+CorrelatedHistogram<T,K>& CorrelatedHistogram<T,K>::transform(const Binning<T>& newBinning, std::vector<K> newValues, const std::vector<K>& jacobian){
+
+  unsigned numberOfChannels = values.size();
+  unsigned numberOfNewChannels = newBinning.getNumberOfChannels();
+  if(newValues.size() != numberOfNewChannels || jacobian.size() != numberOfNewChannels * numberOfChannels){
+
+    Tracer(Verbose::Error)<<"Transforming a correlated histogram with "<<numberOfChannels<<" channels into "<<numberOfNewChannels<<" channels needs as many values and a "<<numberOfNewChannels<<"x"<<numberOfChannels<<" jacobian => Histogram not transformed"<<std::endl;
+    return *this;
+
+  }
+
+  std::vector<K> partialCovariance(numberOfNewChannels * numberOfChannels, K{});//J.C
+  parallel::forEachIndex(numberOfNewChannels, [&](unsigned a){
+
+    K* partialRow = partialCovariance.data() + a * numberOfChannels;
+    for(unsigned i = 0; i < numberOfChannels; ++i){
+
+      K derivative = jacobian[a * numberOfChannels + i];
+      if(derivative == K{}) continue;//jacobians are often sparse
+
+      const K* row = covariance.data() + i * numberOfChannels;
+      for(unsigned j = 0; j < numberOfChannels; ++j) partialRow[j] += derivative * row[j];
+
+    }
+
+  });
+
+  std::vector<K> newCovariance(numberOfNewChannels * numberOfNewChannels, K{});//(J.C).J^T
+  parallel::forEachIndex(numberOfNewChannels, [&](unsigned a){
+
+    const K* partialRow = partialCovariance.data() + a * numberOfChannels;
+    for(unsigned b = 0; b < numberOfNewChannels; ++b){
+
+      const K* jacobianRow = jacobian.data() + b * numberOfChannels;
+      K element{};
+      for(unsigned j = 0; j < numberOfChannels; ++j) element += partialRow[j] * jacobianRow[j];
+      newCovariance[a * numberOfNewChannels + b] = element;
+
+    }
+
+  });
+
+  binning = newBinning;
+  values = std::move(newValues);
+  covariance = std::move(newCovariance);
+  return *this;
+
+}
+
+template <class T, class K>
+const Binning<T>& CorrelatedHistogram<T,K>::getBinning() const{
+
+  return binning;
+
+}
+
+template <class T, class K>
+unsigned CorrelatedHistogram<T,K>::getNumberOfChannels() const{
+
+  return values.size();
+
+}
+
+template <class T, class K>
+const std::vector<K>& CorrelatedHistogram<T,K>::getValues() const{
+
+  return values;
+
+}
+
+template <class T, class K>
+const std::vector<K>& CorrelatedHistogram<T,K>::getCovarianceMatrix() const{
+
+  return covariance;
+
+}
+
+template <class T, class K>
+K CorrelatedHistogram<T,K>::getValue(unsigned channelIndex) const{
+
+  return values.at(channelIndex);
+
+}
+
+template <class T, class K>
+K CorrelatedHistogram<T,K>::getVariance(unsigned channelIndex) const{
+
+  return getCovariance(channelIndex, channelIndex);
+
+}
+
+template <class T, class K>
+K CorrelatedHistogram<T,K>::getCovariance(unsigned channelIndex1, unsigned channelIndex2) const{
+
+  return covariance.at(channelIndex1 * values.size() + channelIndex2);
+
+}
+
+template <class T, class K>
+K CorrelatedHistogram<T,K>::getCorrelation(unsigned channelIndex1, unsigned channelIndex2) const{
+
+  K variances = getVariance(channelIndex1) * getVariance(channelIndex2);
+  if(variances > K{}) return getCovariance(channelIndex1, channelIndex2) / std::sqrt(variances);
+  else return K{};
+
+}
+
+template <class T, class K>
+Scalar<K> CorrelatedHistogram<T,K>::getCount(unsigned channelIndex) const{
+
+  return Scalar<K>{getValue(channelIndex), getVariance(channelIndex)};
+
+}
+
+template <class T, class K>
+K CorrelatedHistogram<T,K>::getTotalCounts() const{
+
+  K totalCounts{};
+  for(const auto& value : values) totalCounts += value;
+  return totalCounts;
+
+}
+
+template <class T, class K>
+K CorrelatedHistogram<T,K>::getChiSquare(const std::vector<K>& expectation) const{
+
+  unsigned numberOfChannels = values.size();
+  if(expectation.size() != numberOfChannels){
+
+    Tracer(Verbose::Error)<<"Comparing a correlated histogram with "<<numberOfChannels<<" channels to "<<expectation.size()<<" expected values => Returning 0"<<std::endl;
+    return K{};
+
+  }
+
+  std::vector<K> lower(covariance);//Cholesky factor L, C = L.L^T, in the lower triangle
+  for(unsigned j = 0; j < numberOfChannels; ++j){
+
+    K diagonal = lower[j * numberOfChannels + j];
+    for(unsigned k = 0; k < j; ++k) diagonal -= lower[j * numberOfChannels + k] * lower[j * numberOfChannels + k];
+    if(!(diagonal > K{})){
+
+      Tracer(Verbose::Error)<<"Covariance matrix is not positive definite (channel "<<j<<") => Returning 0"<<std::endl;
+      return K{};
+
+    }
+
+    diagonal = std::sqrt(diagonal);
+    lower[j * numberOfChannels + j] = diagonal;
+    for(unsigned i = j + 1; i < numberOfChannels; ++i){
+
+      K element = lower[i * numberOfChannels + j];
+      for(unsigned k = 0; k < j; ++k) element -= lower[i * numberOfChannels + k] * lower[j * numberOfChannels + k];
+      lower[i * numberOfChannels + j] = element / diagonal;
+
+    }
+
+  }
+
+  K chiSquare{};
+  std::vector<K> solution(numberOfChannels);//L.y = x - e, then chi square = y^T.y
+  for(unsigned i = 0; i < numberOfChannels; ++i){
+
+    K element = values[i] - expectation[i];
+    for(unsigned k = 0; k < i; ++k) element -= lower[i * numberOfChannels + k] * solution[k];
+    solution[i] = element / lower[i * numberOfChannels + i];
+    chiSquare += solution[i] * solution[i];
+
+  }
+
+  return chiSquare;
+
+}
+
+template <class T, class K>
+DenseHistogram<T,Scalar<K>> CorrelatedHistogram<T,K>::getDenseHistogram() const{
+
+  DenseHistogram<T,Scalar<K>> denseHistogram(binning);
+  for(unsigned k = 0; k < values.size(); ++k) denseHistogram.setCount(k, getCount(k));
+  return denseHistogram;
+
+}
+
+template <class T, class K>
+void CorrelatedHistogram<T,K>::setCount(unsigned channelIndex, const K& value, const K& variance){
+
+  values.at(channelIndex) = value;
+  getCovarianceElement(channelIndex, channelIndex) = variance;
+
+}
+
+template <class T, class K>
+void CorrelatedHistogram<T,K>::setCovariance(unsigned channelIndex1, unsigned channelIndex2, const K& covariance){
+
+  if(channelIndex1 >= values.size() || channelIndex2 >= values.size()) throw std::out_of_range("CorrelatedHistogram has no channel "+std::to_string(std::max(channelIndex1, channelIndex2)));
+
+  getCovarianceElement(channelIndex1, channelIndex2) = covariance;
+  getCovarianceElement(channelIndex2, channelIndex1) = covariance;//kept symmetric
+
+}
+
+#endif
@@ -0,0 +1,616 @@
+#ifndef DENSE_HISTOGRAM_H
+#define DENSE_HISTOGRAM_H
+
+#include "Binning.hpp"
+#include "Scalar.hpp"
+#include "ScalarArray.hpp"
+
+template <class T, class K>
+class DenseHistogram{//histogram whose counts are stored contiguously and whose channels are located through a Binning
+
+  Binning<T> binning;
+  typename CountStore<K>::type counts;//counts following the channel ordering of 'binning', values and variances apart for Scalar<>'s
+
+  template <class BinType, class ValueType>
+  struct HistogramTypes{};//to specialise some methods for <BinType, Scalar<ValueType>>
+
+  template <class BinType, class ValueType>
+  void addCount(HistogramTypes<BinType,ValueType>, unsigned channelIndex);
+  template <class BinType, class ValueType>
+  void addCount(HistogramTypes<BinType,Scalar<ValueType>>, unsigned channelIndex);
+  template <class BinType, class ValueType>
+  void addEntries(HistogramTypes<BinType,ValueType>, const std::vector<unsigned>& entries);
+  template <class BinType, class ValueType>
+  void addEntries(HistogramTypes<BinType,Scalar<ValueType>>, const std::vector<unsigned>& entries);
+  template <class BinType, class ValueType, class Iterator, class WeightIterator>
+  void fillWeighted(HistogramTypes<BinType,ValueType>, Iterator firstCoordinate, Iterator lastCoordinate, WeightIterator firstWeight);
+  template <class BinType, class ValueType, class Iterator, class WeightIterator>
+  void fillWeighted(HistogramTypes<BinType,Scalar<ValueType>>, Iterator firstCoordinate, Iterator lastCoordinate, WeightIterator firstWeight);
+  template <class BinType, class ValueType>
+  K getTotalCounts(HistogramTypes<BinType,ValueType>) const;
+  template <class BinType, class ValueType>
+  K getTotalCounts(HistogramTypes<BinType,Scalar<ValueType>>) const;
+  template <class BinType, class ValueType, class FactorType>
+  void multiplyCounts(HistogramTypes<BinType,ValueType>, const FactorType& factor);
+  template <class BinType, class ValueType, class FactorType>
+  void multiplyCounts(HistogramTypes<BinType,Scalar<ValueType>>, const FactorType& factor);//vectorised in ScalarArray
+  template <class BinType, class ValueType, class FactorType>
+  void divideCountsBy(HistogramTypes<BinType,ValueType>, const FactorType& divider);
+  template <class BinType, class ValueType, class FactorType>
+  void divideCountsBy(HistogramTypes<BinType,Scalar<ValueType>>, const FactorType& divider);
+  template <class BinType, class ValueType, class Operation>
+  void combineCounts(HistogramTypes<BinType,ValueType>, const DenseHistogram<T,K>& other, Operation operation);
+  template <class BinType, class ValueType, class Operation>
+  void combineCounts(HistogramTypes<BinType,Scalar<ValueType>>, const DenseHistogram<T,K>& other, Operation operation);
+  template <class BinType, class ValueType>
+  void divideCounts(HistogramTypes<BinType,ValueType>, const DenseHistogram<T,K>& divider);
+  template <class BinType, class ValueType>
+  void divideCounts(HistogramTypes<BinType,Scalar<ValueType>>, const DenseHistogram<T,K>& divider);
+  template <class BinType, class ValueType>
+  ValueType getNorm(HistogramTypes<BinType,ValueType>) const;
+  template <class BinType, class ValueType>
+  ValueType getNorm(HistogramTypes<BinType,Scalar<ValueType>>) const;
+  template <class Iterator, class Function>
+  void forEachChannel(Iterator firstCoordinate, Iterator lastCoordinate, Function function) const;//calls function(channelIndex) for each group of getDimension() coordinates, channelIndex being getNumberOfChannels() if no channel matches
+
+public:
+  DenseHistogram() = default;
+  template <class Iterator>
+  DenseHistogram(Iterator firstBin, Iterator lastBin);
+  DenseHistogram(const Binning<T>& binning);
+  DenseHistogram<T,K>& operator+=(const DenseHistogram<T,K>& other);//the histograms must share the same binning
+  DenseHistogram<T,K>& operator-=(const DenseHistogram<T,K>& other);
+  DenseHistogram<T,K>& operator*=(const DenseHistogram<T,K>& multiplier);//channel by channel, with uncorrelated errors for Scalar<>'s
+  DenseHistogram<T,K>& operator/=(const DenseHistogram<T,K>& divider);
+  template <class FactorType>
+  DenseHistogram<T,K>& operator*=(const FactorType& factor);
+  template <class FactorType>
+  DenseHistogram<T,K>& operator/=(const FactorType& factor);
+  DenseHistogram<T,K>& normalise();
+  template <class NormType>
+  DenseHistogram<T,K>& scaleCountsTo(const NormType& newNorm);
+  const Binning<T>& getBinning() const;
+  const typename CountStore<K>::type& getCounts() const;
+  K getCount(unsigned channelIndex) const;
+  K getCount(const Point<T>& point) const;
+  K getTotalCounts() const;
+  unsigned getDimension() const;
+  unsigned getNumberOfChannels() const;
+  void addCount(const Point<T>& point);
+  template <class Iterator>
+  void fill(Iterator firstCoordinate, Iterator lastCoordinate);//count the points made of each group of getDimension() consecutive coordinates
+  template <class Container>
+  void fill(const Container& coordinates);
+  template <class Iterator, class WeightIterator>
+  void fillWeighted(Iterator firstCoordinate, Iterator lastCoordinate, WeightIterator firstWeight);//add the weight of each point instead of one count
+  template <class Container, class WeightContainer>
+  void fillWeighted(const Container& coordinates, const WeightContainer& weights);
+  template <class Iterator>
+  void fillSorted(Iterator firstValue, Iterator lastValue);//for 1-D histograms: count values sorted in increasing order with two binary searches per channel
+  template <class Container>
+  void fillSorted(const Container& values);
+  void setCount(unsigned channelIndex, const K& count);
+  DenseHistogram<T,K>& integrateDimensions(std::vector<unsigned> dimensionsToRemove);//for regular binnings: strided reduction of the counts over 'dimensionsToRemove'
+
+};
+
+template <class T, class K>
+std::ostream& operator<<(std::ostream& output, const DenseHistogram<T,K>& histogram){
+
+  for(unsigned k = 0; k < histogram.getNumberOfChannels(); ++k)
+    output<<histogram.getBinning().getChannel(k)<<std::setw(6)<<std::left<<" "<<"-->"<<std::setw(6)<<std::left<<" "<<std::setw(9)<<std::left<<histogram.getCount(k)<<"\n";
+  return output;
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType>
+void DenseHistogram<T,K>::addCount(HistogramTypes<BinType,ValueType>, unsigned channelIndex){
+
+  counts[channelIndex] += ValueType{1};
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType>
+void DenseHistogram<T,K>::addCount(HistogramTypes<BinType,Scalar<ValueType>>, unsigned channelIndex){
+
+  counts[channelIndex] += Scalar<ValueType>{1, 1};//add the statistical error when dealing with Scalar<>
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType>
+void DenseHistogram<T,K>::addEntries(HistogramTypes<BinType,ValueType>, const std::vector<unsigned>& entries){
+
+  for(unsigned k = 0; k < counts.size(); ++k) counts[k] += static_cast<ValueType>(entries[k]);
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType>
+void DenseHistogram<T,K>::addEntries(HistogramTypes<BinType,Scalar<ValueType>>, const std::vector<unsigned>& entries){
+
+  auto& values = counts.getValues();
+  auto& variances = counts.getVariances();
+  for(unsigned k = 0; k < counts.size(); ++k){
+
+    values[k] += entries[k];
+    variances[k] += entries[k];//the Poisson variance of n entries is n
+
+  }
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType, class Iterator, class WeightIterator>
+void DenseHistogram<T,K>::fillWeighted(HistogramTypes<BinType,ValueType>, Iterator firstCoordinate, Iterator lastCoordinate, WeightIterator firstWeight){
+
+  forEachChannel(firstCoordinate, lastCoordinate, [&](unsigned channelIndex){
+
+    if(channelIndex != counts.size()) counts[channelIndex] += *firstWeight;
+    ++firstWeight;
+
+  });
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType, class Iterator, class WeightIterator>
+void DenseHistogram<T,K>::fillWeighted(HistogramTypes<BinType,Scalar<ValueType>>, Iterator firstCoordinate, Iterator lastCoordinate, WeightIterator firstWeight){
+
+  std::vector<ValueType> sumsOfWeights(counts.size()), sumsOfSquaredWeights(counts.size());
+  forEachChannel(firstCoordinate, lastCoordinate, [&](unsigned channelIndex){
+
+    if(channelIndex != counts.size()){
+
+      sumsOfWeights[channelIndex] += *firstWeight;
+      sumsOfSquaredWeights[channelIndex] += (*firstWeight) * (*firstWeight);
+
+    }
+    ++firstWeight;
+
+  });
+
+  auto& values = counts.getValues();
+  auto& variances = counts.getVariances();
+  for(unsigned k = 0; k < counts.size(); ++k){
+
+    values[k] += sumsOfWeights[k];
+    variances[k] += sumsOfSquaredWeights[k];//the variance of a sum of weighted entries is the sum of the squared weights
+
+  }
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType>
+K DenseHistogram<T,K>::getTotalCounts(HistogramTypes<BinType,ValueType>) const{
+
+  K totalCounts{};
+  for(const auto& count : counts) totalCounts += count;
+  return totalCounts;
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType>
+K DenseHistogram<T,K>::getTotalCounts(HistogramTypes<BinType,Scalar<ValueType>>) const{
+
+  return counts.getTotal();
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType, class FactorType>
+void DenseHistogram<T,K>::multiplyCounts(HistogramTypes<BinType,ValueType>, const FactorType& factor){
+
+  for(auto& count : counts) count *= factor;
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType, class FactorType>
+void DenseHistogram<T,K>::multiplyCounts(HistogramTypes<BinType,Scalar<ValueType>>, const FactorType& factor){
+
+  counts *= factor;
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType, class FactorType>
+void DenseHistogram<T,K>::divideCountsBy(HistogramTypes<BinType,ValueType>, const FactorType& divider){
+
+  for(auto& count : counts) count /= divider;
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType, class FactorType>
+void DenseHistogram<T,K>::divideCountsBy(HistogramTypes<BinType,Scalar<ValueType>>, const FactorType& divider){
+
+  counts /= divider;
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType, class Operation>
+void DenseHistogram<T,K>::combineCounts(HistogramTypes<BinType,ValueType>, const DenseHistogram<T,K>& other, Operation operation){
+
+  for(unsigned k = 0; k < counts.size(); ++k) operation(counts[k], other.counts[k]);
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType, class Operation>
+void DenseHistogram<T,K>::combineCounts(HistogramTypes<BinType,Scalar<ValueType>>, const DenseHistogram<T,K>& other, Operation operation){
+
+  operation(counts, other.counts);//whole arrays at once
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType>
+void DenseHistogram<T,K>::divideCounts(HistogramTypes<BinType,ValueType>, const DenseHistogram<T,K>& divider){
+
+  for(unsigned k = 0; k < counts.size(); ++k){
+
+    if(divider.counts[k] != K{}) counts[k] /= divider.counts[k];
+    else Tracer(Verbose::Warning)<<"Histogram division by "<<K{}<<" not allowed!"<<std::endl;
+
+  }
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType>
+void DenseHistogram<T,K>::divideCounts(HistogramTypes<BinType,Scalar<ValueType>>, const DenseHistogram<T,K>& divider){
+
+  counts /= divider.counts;//channels divided by zero are left unchanged
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType>
+ValueType DenseHistogram<T,K>::getNorm(HistogramTypes<BinType,ValueType>) const{
+
+  return getTotalCounts();
+
+}
+
+template <class T, class K>
+template <class BinType, class ValueType>
+ValueType DenseHistogram<T,K>::getNorm(HistogramTypes<BinType,Scalar<ValueType>>) const{
+
+  return getTotalCounts().getValue();//drop the "Scalar" when normalising since we don't want to double count the error on the bin contents
+
+}
+
+template <class T, class K>
+template <class Iterator, class Function>
+void DenseHistogram<T,K>::forEachChannel(Iterator firstCoordinate, Iterator lastCoordinate, Function function) const{
+
+  unsigned dimension = std::max(getDimension(), 1u);
+  unsigned numberOfLostPoints{};
+
+  for(auto it = firstCoordinate; it != lastCoordinate;){
+
+    auto pointBegin = it;
+    unsigned k{};
+    for(; k < dimension && it != lastCoordinate; ++k) ++it;
+
+    if(k < dimension){
+
+      Tracer(Verbose::Warning)<<"Last point is missing "<<dimension - k<<" coordinates => Count not added"<<std::endl;
+      break;
+
+    }
+
+    unsigned channelIndex = binning.findChannel(pointBegin, it);
+    if(channelIndex == counts.size()) ++numberOfLostPoints;
+    function(channelIndex);
+
+  }
+
+  if(numberOfLostPoints != 0) Tracer(Verbose::Warning)<<"No channel matches "<<numberOfLostPoints<<" points => Counts not added"<<std::endl;
+
+}
+
+template <class T, class K>
+template <class Iterator>
+DenseHistogram<T,K>::DenseHistogram(Iterator firstBin, Iterator lastBin):DenseHistogram(Binning<T>(firstBin, lastBin)){
+
+}
+
+template <class T, class K>
+DenseHistogram<T,K>::DenseHistogram(const Binning<T>& binning):binning(binning),counts(binning.getNumberOfChannels(), K{}){
+
+}
+
+template <class T, class K>
+DenseHistogram<T,K>& DenseHistogram<T,K>::operator+=(const DenseHistogram<T,K>& other){
+
+  if(!binning.hasSameChannelsAs(other.binning)) Tracer(Verbose::Error)<<"Adding dense histograms with different channels => Histogram not added"<<std::endl;
+  else combineCounts(HistogramTypes<T,K>{}, other, [](auto& count, const auto& otherCount){count += otherCount;});
+
+  return *this;
+
+}
+
+template <class T, class K>
+DenseHistogram<T,K>& DenseHistogram<T,K>::operator-=(const DenseHistogram<T,K>& other){
+
+  if(!binning.hasSameChannelsAs(other.binning)) Tracer(Verbose::Error)<<"Subtracting dense histograms with different channels => Histogram not subtracted"<<std::endl;
+  else combineCounts(HistogramTypes<T,K>{}, other, [](auto& count, const auto& otherCount){count -= otherCount;});
+
+  return *this;
+
+}
+
+template <class T, class K>
+DenseHistogram<T,K>& DenseHistogram<T,K>::operator*=(const DenseHistogram<T,K>& multiplier){
+
+  if(!binning.hasSameChannelsAs(multiplier.binning)) Tracer(Verbose::Error)<<"Multiplying dense histograms with different channels => Histogram not multiplied"<<std::endl;
+  else combineCounts(HistogramTypes<T,K>{}, multiplier, [](auto& count, const auto& otherCount){count *= otherCount;});
+
+  return *this;
+
+}
+
+template <class T, class K>
+DenseHistogram<T,K>& DenseHistogram<T,K>::operator/=(const DenseHistogram<T,K>& divider){
+
+  if(!binning.hasSameChannelsAs(divider.binning)) Tracer(Verbose::Error)<<"Dividing dense histograms with different channels => Histogram not divided"<<std::endl;
+  else divideCounts(HistogramTypes<T,K>{}, divider);
+
+  return *this;
+
+}
+
+template <class T, class K>
+template <class FactorType>
+DenseHistogram<T,K>& DenseHistogram<T,K>::operator*=(const FactorType& factor){
+
+  multiplyCounts(HistogramTypes<T,K>{}, factor);
+  return *this;
+
+}
+
+template <class T, class K>
+template <class FactorType>
+DenseHistogram<T,K>& DenseHistogram<T,K>::operator/=(const FactorType& factor){
+
+  if(factor != FactorType{}) divideCountsBy(HistogramTypes<T,K>{}, factor);
+  else Tracer(Verbose::Warning)<<"Histogram division by "<<factor<<" not allowed!"<<std::endl;
+
+  return *this;
+
+}
+
+template <class T, class K>
+DenseHistogram<T,K>& DenseHistogram<T,K>::normalise(){
+
+  auto totalCounts = getNorm(HistogramTypes<T,K>{});
+  if(totalCounts != decltype(totalCounts){}) return *this /= totalCounts;
+  else{
+
+    Tracer(Verbose::Warning)<<"Histogram has no counts: already normalised!"<<std::endl;
+    return *this;
+
+  }
+
+}
+
+template <class T, class K>
+template <class NormType>
+DenseHistogram<T,K>& DenseHistogram<T,K>::scaleCountsTo(const NormType& newNorm){
+
+  auto totalCounts = getNorm(HistogramTypes<T,K>{});
+  if(totalCounts != decltype(totalCounts){}) return *this *= newNorm/totalCounts;
+  else return *this;
+
+}
+
+template <class T, class K>
+const Binning<T>& DenseHistogram<T,K>::getBinning() const{
+
+  return binning;
+
+}
+
+template <class T, class K>
+const typename CountStore<K>::type& DenseHistogram<T,K>::getCounts() const{
+
+  return counts;
+
+}
+
+template <class T, class K>
+K DenseHistogram<T,K>::getCount(unsigned channelIndex) const{
+
+  return counts.at(channelIndex);
+
+}
+
+template <class T, class K>
+K DenseHistogram<T,K>::getCount(const Point<T>& point) const{
+
+  unsigned channelIndex = binning.findChannel(point);
+  if(channelIndex != getNumberOfChannels()) return counts[channelIndex];
+  else{
+
+    Tracer(Verbose::Error)<<"No channel matches: "<<point<<" => Returning default content"<<std::endl;
+    return K{};
+
+  }
+
+}
+
+template <class T, class K>
+K DenseHistogram<T,K>::getTotalCounts() const{
+
+  return getTotalCounts(HistogramTypes<T,K>{});
+
+}
+
+template <class T, class K>
+unsigned DenseHistogram<T,K>::getDimension() const{
+
+  return binning.getDimension();
+
+}
+
+template <class T, class K>
+unsigned DenseHistogram<T,K>::getNumberOfChannels() const{
+
+  return counts.size();
+
+}
+
+template <class T, class K>
+void DenseHistogram<T,K>::addCount(const Point<T>& point){
+
+  unsigned channelIndex = binning.findChannel(point);
+  if(channelIndex != getNumberOfChannels()) addCount(HistogramTypes<T,K>{}, channelIndex);
+  else Tracer(Verbose::Warning)<<"No channel matches: "<<point<<" => Count not added"<<std::endl;
+
+}
+
+template <class T, class K>
+template <class Iterator>
+void DenseHistogram<T,K>::fill(Iterator firstCoordinate, Iterator lastCoordinate){
+
+  std::vector<unsigned> entries(counts.size());//count the entries first, so that each channel is only updated once
+  forEachChannel(firstCoordinate, lastCoordinate, [&](unsigned channelIndex){if(channelIndex != counts.size()) ++entries[channelIndex];});
+  addEntries(HistogramTypes<T,K>{}, entries);
+
+}
+
+template <class T, class K>
+template <class Container>
+void DenseHistogram<T,K>::fill(const Container& coordinates){
+
+  fill(coordinates.begin(), coordinates.end());
+
+}
+
+template <class T, class K>
+template <class Iterator, class WeightIterator>
+void DenseHistogram<T,K>::fillWeighted(Iterator firstCoordinate, Iterator lastCoordinate, WeightIterator firstWeight){
+
+  fillWeighted(HistogramTypes<T,K>{}, firstCoordinate, lastCoordinate, firstWeight);
+
+}
+
+template <class T, class K>
+template <class Container, class WeightContainer>
+void DenseHistogram<T,K>::fillWeighted(const Container& coordinates, const WeightContainer& weights){
+
+  fillWeighted(coordinates.begin(), coordinates.end(), weights.begin());
+
+}
+
+template <class T, class K>
+template <class Iterator>
+void DenseHistogram<T,K>::fillSorted(Iterator firstValue, Iterator lastValue){
+
+  if(getDimension() != 1){
+
+    Tracer(Verbose::Warning)<<"Cannot fill a "<<getDimension()<<"-D histogram with sorted values => Counts not added"<<std::endl;
+    return;
+
+  }
+
+  std::vector<unsigned> entries(counts.size());
+  auto itLow = firstValue;
+  for(unsigned k = 0; k < counts.size(); ++k){
+
+    const auto& edge = binning.getChannel(k).getEdge(0);
+    itLow = std::lower_bound(itLow, lastValue, edge.getLowEdge());//channels are ordered, so start from the previous low edge
+    entries[k] = std::lower_bound(itLow, lastValue, edge.getUpEdge()) - itLow;//values in [lowEdge, upEdge[
+
+  }
+
+  addEntries(HistogramTypes<T,K>{}, entries);
+
+}
+
+template <class T, class K>
+template <class Container>
+void DenseHistogram<T,K>::fillSorted(const Container& values){
+
+  fillSorted(values.begin(), values.end());
+
+}
+
+template <class T, class K>
+void DenseHistogram<T,K>::setCount(unsigned channelIndex, const K& count){
+
+  counts.at(channelIndex) = count;
+
+}
+
+template <class T, class K>
+DenseHistogram<T,K>& DenseHistogram<T,K>::integrateDimensions(std::vector<unsigned> dimensionsToRemove){
+
+  if(!binning.isRegular()){
+
+    Tracer(Verbose::Error)<<"Cannot integrate the dimensions of a dense histogram whose channels do not form a regular grid => Histogram not integrated"<<std::endl;
+    return *this;
+
+  }
+
+  std::vector<bool> removed(getDimension(), false);
+  for(auto dimensionToRemove : dimensionsToRemove) if(dimensionToRemove < getDimension()) removed[dimensionToRemove] = true;
+
+  std::vector<std::vector<T>> keptEdges;
+  std::vector<unsigned> strides(getDimension(), 0);//step of the integrated cell index when the index along each axis increases, 0 for the removed axes
+  unsigned stride = 1;
+  for(unsigned k = 0; k < getDimension(); ++k){
+
+    if(removed[k]) continue;
+    keptEdges.emplace_back(binning.getEdges(k));
+    strides[k] = stride;
+    stride *= binning.getNumberOfDivisions(k);
+
+  }
+
+  if(keptEdges.empty()){
+
+    Tracer(Verbose::Warning)<<"Cannot integrate all the dimensions of a dense histogram => Histogram not integrated"<<std::endl;
+    return *this;
+
+  }
+
+  Binning<T> integratedBinning(keptEdges);
+  typename CountStore<K>::type integratedCounts(integratedBinning.getNumberOfChannels(), K{});
+  std::vector<unsigned> axisIndices(getDimension(), 0);
+  unsigned integratedIndex{};
+
+  for(unsigned cellIndex = 0; cellIndex < counts.size(); ++cellIndex){//walk the cells in order, updating the integrated index like an odometer
+
+    integratedCounts[integratedIndex] += counts[cellIndex];
+
+    for(unsigned k = 0; k < getDimension(); ++k){
+
+      if(++axisIndices[k] < binning.getNumberOfDivisions(k)){
+
+        integratedIndex += strides[k];
+        break;
+
+      }
+
+      integratedIndex -= strides[k] * (axisIndices[k] - 1);
+      axisIndices[k] = 0;
+
+    }
+
+  }
+
+  binning = std::move(integratedBinning);
+  counts = std::move(integratedCounts);
+  return *this;
+
+}
+
+#endif
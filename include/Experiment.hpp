@@ -4,6 +4,9 @@
 #include <algorithm>
 #include "Run.hpp"
 #include "Scalar.hpp"
+#include "Binner.hpp"
+#include "Binning.hpp"
+#include "Parallel.hpp"
 
 template <class T,class K>
 class Experiment{//class meant to hold runs in the corresponding configuration bin
@@ -12,9 +15,21 @@ class Experiment{//class meant to hold runs in the corresponding configuration b
   K distance2;// distance to reactor 2
   K backgroundRate;//background rate for all runs of the  map
   std::map<Bin<T>, Run<K>> runMap;//configuration and corresponding extended run containing the detected neutrino rate
+  Binning<T> binning;//index of the channels of runMap to locate a configuration without scanning all the channels
+  std::vector<Run<K>*> indexedRuns;//run of each channel of binning, so that a located configuration needs no map lookup
+  void indexChannels();//to be called whenever the channels of runMap change
+  void indexRuns();
+  const Run<K>* findRun(const Point<T>& configuration) const;//returns nullptr if no channel contains the configuration
+  Run<K>* findRun(const Point<T>& configuration);
 
 public:  
   Experiment(K distance1, K distance2, K backgroundRate = 0);
+  Experiment(const Experiment<T,K>& other);//indexedRuns must point to the copied runs
+  Experiment(Experiment<T,K>&& other) = default;//the nodes of runMap, hence indexedRuns, are transferred
+  Experiment<T,K>& operator=(const Experiment<T,K>& other);
+  Experiment<T,K>& operator=(Experiment<T,K>&& other) = default;
+  Experiment<T,K>& operator+=(const Experiment<T,K>& other);//add the runs of other channel by channel, its channels missing from this experiment are added
+  Experiment<T,K>& operator+=(Experiment<T,K>&& other);//move the runs of other instead of copying them
   K getDistance1() const;
   K getDistance2() const;
   K getBackgroundRate() const;
@@ -25,20 +40,31 @@ public:
   void setBackgroundRate(K backgroundRate);
   unsigned getConfigurationSize() const;
   unsigned getNumberOfChannels() const;
+  const Binning<T>& getBinning() const;
   const Run<K>& getRun(const Point<T>& configuration) const;//get run that corresponds
   template <class BinType, class ValueType, class Iterator>
+  Histogram<BinType, ValueType> getNeutrinoSpectrum(const Point<T>& configuration, Iterator firstBin, Iterator lastBin) const;
+  template <class BinType, class ValueType, class Container>
+  Histogram<BinType, ValueType> getNeutrinoSpectrum(const Point<T>& configuration, const Container& bins) const;
+  template <class BinType, class ValueType, class Iterator>
   Histogram<BinType, ValueType> getScaledNeutrinoSpectrum(const Point<T>& configuration, Iterator firstBin, Iterator lastBin) const;
   template <class BinType, class ValueType, class Container>
   Histogram<BinType, ValueType> getScaledNeutrinoSpectrum(const Point<T>& configuration, const Container& bins) const;
+  template <class BinType, class ValueType, class Iterator>
+  std::map<Bin<T>, Histogram<BinType, ValueType>> getScaledNeutrinoSpectra(Iterator firstBin, Iterator lastBin) const;//scaled spectrum of each configuration, computed in parallel
+  template <class BinType, class ValueType, class Container>
+  std::map<Bin<T>, Histogram<BinType, ValueType>> getScaledNeutrinoSpectra(const Container& bins) const;
   template <class BinType, class ValueType>
-  Histogram<BinType, ValueType> getRateHistogram() const;
+  Histogram<BinType, ValueType> getRateHistogram() const;//the rates of the configurations are computed in parallel
   void emplaceChannel(T binLowEdge, T binUpEdge);
   void addChannel(const Bin<T>& bin);
   template <class Iterator>
   void addChannels(Iterator begin, Iterator end);//copy channels pointed to from begin to end
   template <class Container>
   void addChannels(const Container& channels);//if iterable channels
+  void addChannels(const Binner<T>& binner);//channels on the grid of the axes of binner
   void addRun(const Point<T>& configuration, const Run<K>& run);//add the run to the corresponding configuration
+  void addRun(const Point<T>& configuration, Run<K>&& run);
   void clear();//deletes all channels and runs
   Experiment<T,K>& slim();//removes all channels with no runs
   Experiment<T,K>& integrateChannel(unsigned channelToRemove);
@@ -56,11 +82,116 @@ std::ostream& operator<<(std::ostream& output, const Experiment<T,K>& experiment
   
 }
 
+template <class T,class K>
+void Experiment<T,K>::indexChannels(){
+
+  std::vector<Bin<T>> channels;
+  for(const auto& pair : runMap) channels.emplace_back(pair.first);
+  binning = Binning<T>(channels.begin(), channels.end());
+  indexRuns();
+  
+}
+
+template <class T,class K>
+void Experiment<T,K>::indexRuns(){
+
+  indexedRuns.clear();
+  for(const auto& channel : binning.getChannels()) indexedRuns.emplace_back(&runMap.at(channel));
+
+}
+
+template <class T,class K>
+const Run<K>* Experiment<T,K>::findRun(const Point<T>& configuration) const{
+
+  if(configuration.getDimension() < binning.getDimension()){//the index needs all the coordinates, so scan the channels that contain the given ones
+    
+    auto it = std::find_if(runMap.begin(), runMap.end(),[&](const auto& pairRun){return pairRun.first.contains(configuration);});
+    if(it != runMap.end()) return &it->second;
+    else return nullptr;
+    
+  }
+  
+  unsigned channelIndex = binning.findChannel(configuration);
+  if(channelIndex != binning.getNumberOfChannels()) return indexedRuns[channelIndex];
+  else return nullptr;
+  
+}
+
+template <class T,class K>
+Run<K>* Experiment<T,K>::findRun(const Point<T>& configuration){
+
+  return const_cast<Run<K>*>(static_cast<const Experiment<T,K>&>(*this).findRun(configuration));
+
+}
+
 template <class T,class K>
 Experiment<T,K>::Experiment(K distance1, K distance2, K backgroundRate):distance1(distance1),distance2(distance2),backgroundRate(backgroundRate){
 
 }
 
+template <class T,class K>
+Experiment<T,K>::Experiment(const Experiment<T,K>& other):distance1(other.distance1),distance2(other.distance2),backgroundRate(other.backgroundRate),runMap(other.runMap),binning(other.binning){
+
+  indexRuns();
+
+}
+
+template <class T,class K>
+Experiment<T,K>& Experiment<T,K>::operator=(const Experiment<T,K>& other){
+
+  return *this = Experiment<T,K>(other);
+
+}
+
+template <class T,class K>
+Experiment<T,K>& Experiment<T,K>::operator+=(const Experiment<T,K>& other){
+  
+  if(other.distance1 != distance1 || other.distance2 != distance2 || other.backgroundRate != backgroundRate) Tracer(Verbose::Warning)<<"Adding an experiment with different distances or background rate => Keeping the ones of the first experiment"<<std::endl;
+  
+  bool newChannels = false;
+  for(const auto& pair : other.runMap){
+    
+    auto itRun = runMap.find(pair.first);
+    if(itRun != runMap.end()) itRun->second += pair.second;
+    else{
+      
+      runMap.emplace(pair.first, pair.second);
+      newChannels = true;
+      
+    }
+    
+  }
+  
+  if(newChannels) indexChannels();
+  return *this;
+  
+}
+
+template <class T,class K>
+Experiment<T,K>& Experiment<T,K>::operator+=(Experiment<T,K>&& other){
+  
+  if(other.distance1 != distance1 || other.distance2 != distance2 || other.backgroundRate != backgroundRate) Tracer(Verbose::Warning)<<"Adding an experiment with different distances or background rate => Keeping the ones of the first experiment"<<std::endl;
+  
+  bool newChannels = false;
+  for(auto& pair : other.runMap){
+    
+    auto itRun = runMap.find(pair.first);
+    if(itRun != runMap.end()) itRun->second += std::move(pair.second);
+    else{
+      
+      runMap.emplace(pair.first, std::move(pair.second));
+      newChannels = true;
+      
+    }
+    
+  }
+  
+  other.clear();
+  if(newChannels) indexChannels();
+  return *this;
+  
+}
+
 template <class T,class K>
 K Experiment<T,K>::getDistance1() const{
   
@@ -97,11 +228,18 @@ unsigned Experiment<T,K>::getNumberOfChannels() const{
   
 }
 
+template <class T,class K>
+const Binning<T>& Experiment<T,K>::getBinning() const{
+
+  return binning;
+  
+}
+
 template <class T,class K>
 const Run<K>& Experiment<T,K>::getRun(const Point<T>& configuration) const{
 
-  auto it = std::find_if(runMap.begin(), runMap.end(),[&](const auto& pairRun){return pairRun.first.contains(configuration);});
-  if(it != runMap.end()) return it->second;
+  auto run = findRun(configuration);
+  if(run) return *run;
   else{
     
     Tracer(Verbose::Error)<<"No run matches: "<<configuration<<" => Returning first run"<<std::endl;
@@ -111,6 +249,22 @@ const Run<K>& Experiment<T,K>::getRun(const Point<T>& configuration) const{
   
 }
 
+template <class T,class K>
+template <class BinType, class ValueType, class Iterator>
+Histogram<BinType, ValueType> Experiment<T,K>::getNeutrinoSpectrum(const Point<T>& configuration, Iterator firstBin, Iterator lastBin) const{
+
+  return getRun(configuration).template getNeutrinoSpectrum<BinType,ValueType>(firstBin, lastBin);
+  
+}
+
+template <class T,class K>
+template <class BinType, class ValueType, class Container>
+Histogram<BinType, ValueType> Experiment<T,K>::getNeutrinoSpectrum(const Point<T>& configuration, const Container& bins) const{
+
+  return getNeutrinoSpectrum<BinType,ValueType>(configuration, bins.begin(), bins.end());
+  
+}
+
 template <class T,class K>
 template <class BinType, class ValueType, class Iterator>
 Histogram<BinType, ValueType> Experiment<T,K>::getScaledNeutrinoSpectrum(const Point<T>& configuration, Iterator firstBin, Iterator lastBin) const{
@@ -127,12 +281,42 @@ Histogram<BinType, ValueType> Experiment<T,K>::getScaledNeutrinoSpectrum(const P
   
 }
 
+template <class T,class K>
+template <class BinType, class ValueType, class Iterator>
+std::map<Bin<T>, Histogram<BinType, ValueType>> Experiment<T,K>::getScaledNeutrinoSpectra(Iterator firstBin, Iterator lastBin) const{
+
+  std::vector<const std::pair<const Bin<T>, Run<K>>*> pairs;
+  for(const auto& pair : runMap) pairs.emplace_back(&pair);
+  
+  std::vector<Histogram<BinType, ValueType>> spectra(pairs.size());
+  parallel::forEachIndex(pairs.size(), [&](unsigned k){spectra[k] = pairs[k]->second.template getScaledNeutrinoSpectrum<BinType,ValueType>(distance1, distance2, backgroundRate, firstBin, lastBin);});
+  
+  std::map<Bin<T>, Histogram<BinType, ValueType>> spectrumMap;
+  for(unsigned k = 0; k < pairs.size(); ++k) spectrumMap.emplace_hint(spectrumMap.end(), pairs[k]->first, std::move(spectra[k]));//the runs are already ordered
+  return spectrumMap;
+  
+}
+
+template <class T,class K>
+template <class BinType, class ValueType, class Container>
+std::map<Bin<T>, Histogram<BinType, ValueType>> Experiment<T,K>::getScaledNeutrinoSpectra(const Container& bins) const{
+
+  return getScaledNeutrinoSpectra<BinType,ValueType>(bins.begin(), bins.end());
+  
+}
+
 template <class T,class K>
 template <class BinType, class ValueType>
 Histogram<BinType, ValueType> Experiment<T,K>::getRateHistogram() const{
 
+  std::vector<const std::pair<const Bin<T>, Run<K>>*> pairs;//random access to the runs for the threads
+  for(const auto& pair : runMap) pairs.emplace_back(&pair);
+  
+  std::vector<ValueType> rates(pairs.size());
+  parallel::forEachIndex(pairs.size(), [&](unsigned k){rates[k] = pairs[k]->second.template getNeutrinoRate<ValueType>(distance1, distance2, backgroundRate);});
+  
   Histogram<BinType, ValueType> rate;
-  for(const auto& pair : runMap) rate.setCount(pair.first, pair.second.template getNeutrinoRate<ValueType>(distance1, distance2, backgroundRate));
+  for(unsigned k = 0; k < pairs.size(); ++k) rate.setCount(pairs[k]->first, rates[k]);
   return rate;
 
 }
@@ -182,7 +366,7 @@ void Experiment<T,K>::emplaceChannel(T binLowEdge, T binUpEdge){
 template <class T,class K>
 void Experiment<T,K>::addChannel(const Bin<T>& bin){
   
-  runMap.emplace(bin, Run<K>{});//default construct the Run<K> to zero neutrinos and zero time
+  if(runMap.emplace(bin, Run<K>{}).second) indexChannels();//default construct the Run<K> to zero neutrinos and zero time
 
 }
 
@@ -190,7 +374,9 @@ template <class T,class K>
 template <class Iterator>
 void Experiment<T,K>::addChannels(Iterator begin, Iterator end){
 
-  for(auto it = begin; it != end; ++it) addChannel(*it);
+  bool newChannels = false;
+  for(auto it = begin; it != end; ++it) newChannels = runMap.emplace(*it, Run<K>{}).second || newChannels;
+  if(newChannels) indexChannels();//only index once all channels are added
   
 }
 
@@ -202,11 +388,28 @@ void Experiment<T,K>::addChannels(const Container& channels){
 
 }
 
+template <class T,class K>
+void Experiment<T,K>::addChannels(const Binner<T>& binner){
+  
+  Binning<T> grid(binner.getAxes());
+  addChannels(grid.getChannels());
+
+}
+
 template <class T,class K>
 void Experiment<T,K>::addRun(const Point<T>& configuration, const Run<K>& run){
 
-  auto it = std::find_if(runMap.begin(), runMap.end(),[&](const auto& pair){return pair.first.contains(configuration);});
-  if(it != runMap.end()) it->second += run;
+  auto runToComplete = findRun(configuration);
+  if(runToComplete) *runToComplete += run;
+  else Tracer(Verbose::Warning)<<"No channel matches: "<<configuration<<" => Run<K> not added"<<std::endl;
+  
+}
+
+template <class T,class K>
+void Experiment<T,K>::addRun(const Point<T>& configuration, Run<K>&& run){
+
+  auto runToComplete = findRun(configuration);
+  if(runToComplete) *runToComplete += std::move(run);
   else Tracer(Verbose::Warning)<<"No channel matches: "<<configuration<<" => Run<K> not added"<<std::endl;
   
 }
@@ -215,6 +418,7 @@ template <class T,class K>
 void Experiment<T,K>::clear(){
   
   runMap.clear();
+  indexChannels();
 
 }
 
@@ -229,6 +433,7 @@ Experiment<T,K>& Experiment<T,K>::slim(){
     
   }
   
+  indexChannels();
   return *this;
 
 }
@@ -236,16 +441,28 @@ Experiment<T,K>& Experiment<T,K>::slim(){
 template <class T,class K>
 Experiment<T,K>& Experiment<T,K>::integrateChannel(unsigned channelToRemove){
 
-  return integrateChannel({channelToRemove});
+  return integrateChannels({channelToRemove});
   
 }
 
 template <class T,class K>
 Experiment<T,K>& Experiment<T,K>::integrateChannels(std::vector<unsigned> channelsToRemove){
 
+  std::vector<std::pair<Bin<T>, Run<K>*>> compactedChannels;//each bin is compacted only once
+  compactedChannels.reserve(runMap.size());
+  for(auto& pair : runMap) compactedChannels.emplace_back(compact(pair.first, channelsToRemove), &pair.second);
+  std::stable_sort(compactedChannels.begin(), compactedChannels.end(), [](const auto& channel1, const auto& channel2){return channel1.first < channel2.first;});
+
   std::map<Bin<T>, Run<K>> integratedMap;
-  for(auto& pair : runMap) integratedMap[compact(pair.first, channelsToRemove)] += pair.second;//compact the bin add the content of the old bin to the new map at the compacted bin
+  for(auto& channel : compactedChannels){//the channels merged together are now consecutive, so the map is built in order
+
+    if(!integratedMap.empty() && !(integratedMap.rbegin()->first < channel.first)) integratedMap.rbegin()->second += std::move(*channel.second);
+    else integratedMap.emplace_hint(integratedMap.end(), std::move(channel.first), std::move(*channel.second));
+
+  }
+
   std::swap(runMap, integratedMap);//update countMap
+  indexChannels();
 
   return *this;
   
@@ -1,27 +1,39 @@
 #ifndef EXPERIMENTEXTRACTOR_H
 #define EXPERIMENTEXTRACTOR_H
 
+#include <vector>
+#include <unordered_map>
+#include <string>
 #include "TTree.h"
-#include "Experiment.hpp"
-#include "Reactor.hpp"
+#include "RunTable.hpp"
 #include "Constants.hpp"
 
-class ExperimentExtractor{
-  TTree* data;
-  TTree* simu1;
-  TTree* simu2;
+class ExperimentExtractor{//accumulates the data and simulation trees, possibly spread over several files, before joining them by run number
 //for data tree  
-  int runData;
-  double currentEnergy;
+  struct DataChunk{//consecutive entries of a data tree
+    
+    std::vector<int> runs;
+    std::vector<double> energies;
+    
+  };
+  std::unordered_map<int, std::vector<double>> energiesData;//run number -> energies of the data entries of the run, kept sorted as the chunks are appended
 //for simulation trees  
   int runSimu;
-  double runLength, numberOfNeutrinosSimu1, power1, f239Pu_1, f241Pu_1, f235U_1, f238U_1;
-  double numberOfNeutrinosSimu2, power2, f239Pu_2, f241Pu_2, f235U_2, f238U_2;
+  double runLength, power1, f239Pu_1, f241Pu_1, f235U_1, f238U_1;
+  double power2, f239Pu_2, f241Pu_2, f235U_2, f238U_2;
+  RunTable simulatedRuns;//runs of the simulation trees, without neutrinos
+  void appendDataChunk(const DataChunk& chunk);//group the entries by run and merge them into the sorted energies of their run, so that the runs are ready once the files are read
 
 public:
-  ExperimentExtractor() = delete;
+  ExperimentExtractor() = default;
   ExperimentExtractor(TTree* data, TTree* simu1, TTree* simu2);
   ~ExperimentExtractor() = default;//do not release the pointers you do not own
+  void addDataTree(TTree* data);//read the needed columns of the tree, which can be deleted afterwards
+  void addSimulationTrees(TTree* simu1, TTree* simu2);//simu1 and simu2 must have the same number of entries
+  bool addDataFile(const std::string& path, const char* treeName = "FinalFitIBDTree");//the file is closed once read, returns false if the tree cannot be read
+  bool addDataFiles(const std::vector<std::string>& paths, unsigned queueDepth = 4, const char* treeName = "FinalFitIBDTree");//a reading thread decompresses the files chunk by chunk while this one groups and sorts the entries of the chunks by run, at most queueDepth chunks waiting in between, returns false if a tree cannot be read
+  bool addSimulationFiles(const std::string& path1, const std::string& path2, const char* treeName = "nu");//returns false if a tree cannot be read
+  RunTable extractRunTable();//join the accumulated trees, the table can then be saved and reloaded instead of reading them again
   template <class T, class K, class Iterator>
   Experiment<T,K> extractExperiment(double distance1, double distance2, double backgroundRate, Iterator beginChannel, Iterator endChannel);
   template <class T, class K, class Container>
@@ -32,48 +44,7 @@ public:
 template <class T, class K, class Iterator>
 Experiment<T,K> ExperimentExtractor::extractExperiment(double distance1, double distance2, double backgroundRate, Iterator beginChannel, Iterator endChannel){
   
-  std::vector<Particle> neutrinos;
-  Reactor reactor1, reactor2;
-  reactor1.setDistanceToDetector(distance1);
-  reactor2.setDistanceToDetector(distance2);
-  Fuel equivalentFuel;
-
-  Experiment<T,K> experiment(distance1, distance2, backgroundRate);
-  experiment.addChannels(beginChannel, endChannel);
-  
-  unsigned i = 0;
-  data->GetEntry(i);
-  
-  for(unsigned k = 0; k<simu1->GetEntries(); ++k){//simu1 and simu2 have the same number of entries
-
-    simu1->GetEntry(k);
-    simu2->GetEntry(k);
-    
-    constants::adaptUnits(runLength, power1, power2);
-    
-    while(runData == runSimu && i < data->GetEntries()-1){
-      
-      neutrinos.emplace_back(Particle(currentEnergy));
-      data->GetEntry(++i);
-    
-    }
-    
-    reactor1.setPower(power1);
-    reactor1.setFuel(Fuel(f235U_1,f238U_1,f239Pu_1,f241Pu_1));
-    reactor2.setPower(power2);
-    reactor2.setFuel(Fuel(f235U_2,f238U_2,f239Pu_2,f241Pu_2));
-    equivalentFuel = (reactor1 + reactor2).getFuel();
-
-    experiment.addRun(
-      Point<double>{equivalentFuel.getFrac("235U"), equivalentFuel.getFrac("238U"), equivalentFuel.getFrac("239Pu"), equivalentFuel.getFrac("241Pu")}, 
-      Run<double>(neutrinos, runLength, power1, power2)
-    );
-    
-    neutrinos.resize(0);
-
-  }
-
-  return experiment;
+  return extractRunTable().getExperiment<T,K>(distance1, distance2, backgroundRate, beginChannel, endChannel);
   
 }
 
@@ -2,14 +2,32 @@
 #define HISTOGRAM_H
 
 #include <map>
+#include <memory>
+#include <algorithm>
+#include <functional>
 #include "Bin.hpp"
 #include "Scalar.hpp"
+#include "DenseHistogram.hpp"
+
+template <class Derived>
+class HistogramExpression;
+
+struct ChannelDescriptor{//hash of the channels of a histogram, shared by the histograms known to have the same channels
+
+  std::size_t hash;
+  unsigned numberOfChannels;
+
+};
 
 template <class T, class K>
 class Histogram{
 
   std::map<Bin<T>, K> countMap;//map to store the counts for Bin<T>
   
+  mutable std::shared_ptr<const ChannelDescriptor> channelDescriptor;//built on demand, copied along with countMap and dropped whenever the channels change, always accessed atomically since const methods set it
+  std::shared_ptr<const ChannelDescriptor> getChannelDescriptor() const;
+  void dropChannelDescriptor();
+  
   template <class BinType, class ValueType>
   struct HistogramTypes{};//to specialise some methods for <BinType, Scalar<ValueType>>
   
@@ -26,15 +44,32 @@ class Histogram{
   template <class BinType, class ValueType>
   void addCount(HistogramTypes<BinType,Scalar<ValueType>>, const Point<T>& point);
   
+  template <class OtherBinType, class OtherValueType>
+  friend class Histogram;
+  
 public:
   Histogram() = default;
   template <class Iterator>
   Histogram(Iterator firstBin, Iterator lastBin);
+  explicit Histogram(const DenseHistogram<T,K>& denseHistogram);
+  Histogram(const Histogram<T,K>& other);//reads the channel descriptor of other atomically
+  Histogram(Histogram<T,K>&& other) = default;
+  Histogram<T,K>& operator=(const Histogram<T,K>& other);
+  Histogram<T,K>& operator=(Histogram<T,K>&& other) = default;
+  template <class Derived>
+  Histogram(const HistogramExpression<Derived>& expression);//evaluate the result of histogram arithmetic
+  template <class Derived>
+  Histogram<T,K>& operator=(const HistogramExpression<Derived>& expression);
   Histogram<T,K> operator-();
   template <class OtherBinType, class OtherValueType>
   Histogram<T,K>& operator+=(const Histogram<OtherBinType,OtherValueType>& other);
+  Histogram<T,K>& operator+=(const DenseHistogram<T,K>& denseHistogram);
+  template <class Derived>
+  Histogram<T,K>& operator+=(const HistogramExpression<Derived>& expression);
   template <class OtherBinType, class OtherValueType>
   Histogram<T,K>& operator-=(const Histogram<OtherBinType,OtherValueType>& other);
+  template <class Derived>
+  Histogram<T,K>& operator-=(const HistogramExpression<Derived>& expression);
   template <class FactorType>
   Histogram<T,K>& operator*=(const FactorType& factor);
   template <class OtherBinType, class OtherValueType>
@@ -56,12 +91,29 @@ public:
   K getCount(const Point<T>& point) const;
   K getCount(const Bin<T>& bin) const;
   K getTotalCounts() const;
+  DenseHistogram<T,K> getEmptyDenseHistogram() const;//dense histogram with the channels of countMap and no counts
   unsigned getDimension() const;
   unsigned getNumberOfChannels() const;
+  template <class OtherBinType, class OtherValueType>
+  bool hasSameChannelsAs(const Histogram<OtherBinType,OtherValueType>& other) const;//different bin types never have the same channels
+  template <class OtherValueType>
+  bool hasSameChannelsAs(const Histogram<T,OtherValueType>& other) const;//O(1) when the histograms share their channel descriptor, otherwise the channels are compared once and the descriptor is shared
   void addChannel(const Bin<T>& bin);
   template <class Iterator>
   void addChannels(Iterator begin, Iterator end);//copy channels pointed to from begin to end
   void addCount(const Point<T>& point);
+  template <class Iterator>
+  void fill(Iterator firstCoordinate, Iterator lastCoordinate);//count the points made of each group of getDimension() consecutive coordinates
+  template <class Container>
+  void fill(const Container& coordinates);
+  template <class Iterator, class WeightIterator>
+  void fillWeighted(Iterator firstCoordinate, Iterator lastCoordinate, WeightIterator firstWeight);//add the weight of each point instead of one count
+  template <class Container, class WeightContainer>
+  void fillWeighted(const Container& coordinates, const WeightContainer& weights);
+  template <class Iterator>
+  void fillSorted(Iterator firstValue, Iterator lastValue);//for 1-D histograms: count values sorted in increasing order
+  template <class Container>
+  void fillSorted(const Container& values);
   void setCount(const Bin<T>& bin, const K& count);
   
 };
@@ -74,53 +126,34 @@ std::ostream& operator<<(std::ostream& output, const Histogram<T,K>& histogram){
   
 }
 
-template <class T1, class K1, class T2, class K2>
-Histogram<T1,K1> operator+(Histogram<T1,K1> histogram1, const Histogram<T2,K2>& histogram2){
-  
-  return histogram1 += histogram2;
-  
-}
+template <class T, class K>
+std::shared_ptr<const ChannelDescriptor> Histogram<T,K>::getChannelDescriptor() const{
 
-template <class T1, class K1, class T2, class K2>
-Histogram<T1,K1> operator-(Histogram<T1,K1> histogram1, const Histogram<T2,K2>& histogram2){
-  
-  return histogram1 -= histogram2;
-  
-}
+  auto descriptor = std::atomic_load(&channelDescriptor);
+  if(descriptor) return descriptor;
 
-template <class T, class K, class FactorType>
-Histogram<T,K> operator*(Histogram<T,K> histogram, const FactorType& factor){
-  
-  return histogram *= factor;
-  
-}
+  std::size_t hash = countMap.size();
+  std::hash<T> hashEdge;
+  auto combine = [&](const T& edge){hash ^= hashEdge(edge) + 0x9e3779b9 + (hash << 6) + (hash >> 2);};
+  for(const auto& pair : countMap)
+    for(unsigned k = 0; k < pair.first.getDimension(); ++k){//both edges, since bins with the same centers can have different widths
 
-template <class T, class K, class FactorType>
-Histogram<T,K> operator*(const FactorType& factor, Histogram<T,K> histogram){
-  
-  return histogram * factor;
-  
-}
+      combine(pair.first.getEdge(k).getLowEdge());
+      combine(pair.first.getEdge(k).getUpEdge());
 
-template <class T1, class K1, class T2, class K2>
-Histogram<T1,K1> operator*(Histogram<T1,K1> histogram1, const Histogram<T2,K2>& histogram2){
-  
-  return histogram1 *= histogram2;
-  
-}
+    }
+
+  descriptor = std::make_shared<const ChannelDescriptor>(ChannelDescriptor{hash, static_cast<unsigned>(countMap.size())});
+  std::atomic_store(&channelDescriptor, descriptor);
+  return descriptor;
 
-template <class T, class K, class FactorType>
-Histogram<T,K> operator/(Histogram<T,K> histogram, const FactorType& factor){
-  
-  return histogram /= factor;
-  
 }
 
-template <class T1, class K1, class T2, class K2>
-Histogram<T1,K1> operator/(Histogram<T1,K1> histogram1, const Histogram<T2,K2>& histogram2){
-  
-  return histogram1 /= histogram2;
-  
+template <class T, class K>
+void Histogram<T,K>::dropChannelDescriptor(){
+
+  std::atomic_store(&channelDescriptor, std::shared_ptr<const ChannelDescriptor>());
+
 }
 
 template <class T, class K>
@@ -202,6 +235,41 @@ Histogram<T,K>::Histogram(Iterator firstBin, Iterator lastBin){
   
 }
 
+template <class T, class K>
+Histogram<T,K>::Histogram(const DenseHistogram<T,K>& denseHistogram){
+  
+  for(unsigned k = 0; k < denseHistogram.getNumberOfChannels(); ++k) countMap.emplace(denseHistogram.getBinning().getChannel(k), denseHistogram.getCount(k));
+  
+}
+
+template <class T, class K>
+Histogram<T,K>::Histogram(const Histogram<T,K>& other):countMap(other.countMap),channelDescriptor(std::atomic_load(&other.channelDescriptor)){
+
+}
+
+template <class T, class K>
+Histogram<T,K>& Histogram<T,K>::operator=(const Histogram<T,K>& other){
+
+  countMap = other.countMap;
+  std::atomic_store(&channelDescriptor, std::atomic_load(&other.channelDescriptor));
+  return *this;
+
+}
+
+template <class T, class K>
+template <class Derived>
+Histogram<T,K>::Histogram(const HistogramExpression<Derived>& expression):Histogram(expression.evaluate()){
+
+}
+
+template <class T, class K>
+template <class Derived>
+Histogram<T,K>& Histogram<T,K>::operator=(const HistogramExpression<Derived>& expression){
+
+  return *this = expression.evaluate();
+
+}
+
 template <class T, class K>
 Histogram<T,K> Histogram<T,K>::operator-(){
 
@@ -215,20 +283,73 @@ template <class T, class K>
 template <class OtherBinType, class OtherValueType>
 Histogram<T,K>& Histogram<T,K>::operator+=(const Histogram<OtherBinType,OtherValueType>& other){
 
-  for(auto& pair : other) countMap[pair.first] += pair.second;
+  if(hasSameChannelsAs(other)){//add channel by channel without looking the bins up
+
+    auto otherIt = other.begin();
+    for(auto& pair : countMap) pair.second += (otherIt++)->second;
+
+  }
+  else{//union of the channels
+
+    unsigned numberOfChannels = countMap.size();
+    for(auto& pair : other) countMap[pair.first] += pair.second;
+    if(countMap.size() != numberOfChannels) dropChannelDescriptor();
+
+  }
+
+  return *this;
+  
+}
+
+template <class T, class K>
+Histogram<T,K>& Histogram<T,K>::operator+=(const DenseHistogram<T,K>& denseHistogram){
+
+  unsigned numberOfChannels = countMap.size();
+  for(unsigned k = 0; k < denseHistogram.getNumberOfChannels(); ++k)
+    if(denseHistogram.getCount(k) != K{}) countMap[denseHistogram.getBinning().getChannel(k)] += denseHistogram.getCount(k);
+  if(countMap.size() != numberOfChannels) dropChannelDescriptor();
   return *this;
   
 }
 
+template <class T, class K>
+template <class Derived>
+Histogram<T,K>& Histogram<T,K>::operator+=(const HistogramExpression<Derived>& expression){
+
+  return *this += expression.evaluate();
+  
+}
+
 template <class T, class K>
 template <class OtherBinType, class OtherValueType>
 Histogram<T,K>& Histogram<T,K>::operator-=(const Histogram<OtherBinType,OtherValueType>& other){
 
-  for(auto& pair : other) countMap[pair.first] -= pair.second;
+  if(hasSameChannelsAs(other)){
+
+    auto otherIt = other.begin();
+    for(auto& pair : countMap) pair.second -= (otherIt++)->second;
+
+  }
+  else{
+
+    unsigned numberOfChannels = countMap.size();
+    for(auto& pair : other) countMap[pair.first] -= pair.second;
+    if(countMap.size() != numberOfChannels) dropChannelDescriptor();
+
+  }
+
   return *this;
   
 }
 
+template <class T, class K>
+template <class Derived>
+Histogram<T,K>& Histogram<T,K>::operator-=(const HistogramExpression<Derived>& expression){
+
+  return *this -= expression.evaluate();
+  
+}
+
 template <class T, class K>
 template <class FactorType>
 Histogram<T,K>& Histogram<T,K>::operator*=(const FactorType& factor){
@@ -242,8 +363,15 @@ template <class T, class K>
 template <class OtherBinType, class OtherValueType>
 Histogram<T,K>& Histogram<T,K>::operator*=(const Histogram<OtherBinType,OtherValueType>& multiplier){
 
-  for(auto itPair = std::make_pair(begin(),multiplier.begin()); itPair.first != end() && itPair.second != multiplier.end(); ++itPair.first, ++itPair.second)
-    itPair.first->second *= itPair.second->second; 
+  if(!hasSameChannelsAs(multiplier)){
+
+    Tracer(Verbose::Error)<<"Multiplying histograms with different channels => Histogram not multiplied"<<std::endl;
+    return *this;
+
+  }
+
+  auto multiplierIt = multiplier.begin();
+  for(auto& pair : countMap) pair.second *= (multiplierIt++)->second;
   return *this;
   
 }
@@ -266,12 +394,20 @@ template <class T, class K>
 template <class OtherBinType, class OtherValueType>
 Histogram<T,K>& Histogram<T,K>::operator/=(const Histogram<OtherBinType,OtherValueType>& divider){
 
+  if(!hasSameChannelsAs(divider)){
+
+    Tracer(Verbose::Error)<<"Dividing histograms with different channels => Histogram not divided"<<std::endl;
+    return *this;
+
+  }
+
   K zero{};
-  
-  for(auto itPair = std::make_pair(begin(),divider.begin()); itPair.first != end() && itPair.second != divider.end(); ++itPair.first, ++itPair.second){
+  auto dividerIt = divider.begin();
+  for(auto& pair : countMap){
     
-    if(itPair.second->second != zero) itPair.first->second /= itPair.second->second;
+    if(dividerIt->second != zero) pair.second /= dividerIt->second;
     else Tracer(Verbose::Warning)<<"Histogram division by "<<zero<<" not allowed!"<<std::endl;
+    ++dividerIt;
     
   }
     
@@ -300,6 +436,7 @@ Histogram<T,K>& Histogram<T,K>::shiftChannels(const Point<T>& point){
   std::map<Bin<T>,K> shiftedMap;//we cannot modify the keys of a map, so create a new map
   for(const auto& pair : countMap) shiftedMap[shift(pair.first, point)] = pair.second;//shift the bins before inserting the key in the map
   std::swap(countMap, shiftedMap);//update countMap
+  dropChannelDescriptor();
   
   return *this;
 
@@ -315,9 +452,21 @@ Histogram<T,K>& Histogram<T,K>::integrateDimension(unsigned dimensionToRemove){
 template <class T, class K>
 Histogram<T,K>& Histogram<T,K>::integrateDimensions(std::vector<unsigned> dimensionsToRemove){
 
+  std::vector<std::pair<Bin<T>, K*>> compactedChannels;//each bin is compacted only once
+  compactedChannels.reserve(countMap.size());
+  for(auto& pair : countMap) compactedChannels.emplace_back(compact(pair.first, dimensionsToRemove), &pair.second);
+  std::stable_sort(compactedChannels.begin(), compactedChannels.end(), [](const auto& channel1, const auto& channel2){return channel1.first < channel2.first;});
+
   std::map<Bin<T>, K> integratedMap;
-  for(auto& pair : countMap) integratedMap[compact(pair.first, dimensionsToRemove)] += pair.second;//compact the bin add the content of the old bin to the new map at the compacted bin
+  for(auto& channel : compactedChannels){//the channels merged together are now consecutive, so the map is built in order
+
+    if(!integratedMap.empty() && !(integratedMap.rbegin()->first < channel.first)) integratedMap.rbegin()->second += *channel.second;
+    else integratedMap.emplace_hint(integratedMap.end(), std::move(channel.first), std::move(*channel.second));
+
+  }
+
   std::swap(countMap, integratedMap);//update countMap
+  dropChannelDescriptor();
 
   return *this;
   
@@ -381,6 +530,15 @@ K Histogram<T,K>::getTotalCounts() const{
   
 }
 
+template <class T, class K>
+DenseHistogram<T,K> Histogram<T,K>::getEmptyDenseHistogram() const{
+
+  std::vector<Bin<T>> bins;
+  for(const auto& pair : countMap) bins.emplace_back(pair.first);
+  return DenseHistogram<T,K>(bins.begin(), bins.end());
+
+}
+
 template <class T, class K>
 unsigned Histogram<T,K>::getDimension() const{
 
@@ -396,11 +554,41 @@ unsigned Histogram<T,K>::getNumberOfChannels() const{
   
 }
 
+template <class T, class K>
+template <class OtherBinType, class OtherValueType>
+bool Histogram<T,K>::hasSameChannelsAs(const Histogram<OtherBinType,OtherValueType>&) const{
+
+  return false;
+
+}
+
+template <class T, class K>
+template <class OtherValueType>
+bool Histogram<T,K>::hasSameChannelsAs(const Histogram<T,OtherValueType>& other) const{
+
+  auto descriptor = getChannelDescriptor();
+  auto otherDescriptor = other.getChannelDescriptor();
+  if(descriptor == otherDescriptor) return true;//copies of one another, or already compared
+  if(descriptor->hash != otherDescriptor->hash || descriptor->numberOfChannels != otherDescriptor->numberOfChannels) return false;
+
+  bool sameChannels = std::equal(countMap.begin(), countMap.end(), other.begin(), [](const auto& pairBin1, const auto& pairBin2){//rules out hash collisions, comparing the edges exactly
+
+    if(pairBin1.first.getDimension() != pairBin2.first.getDimension()) return false;
+    for(unsigned k = 0; k < pairBin1.first.getDimension(); ++k)
+      if(pairBin1.first.getEdge(k).getLowEdge() != pairBin2.first.getEdge(k).getLowEdge() || pairBin1.first.getEdge(k).getUpEdge() != pairBin2.first.getEdge(k).getUpEdge()) return false;
+    return true;
+
+  });
+  if(sameChannels) std::atomic_compare_exchange_strong(&other.channelDescriptor, &otherDescriptor, descriptor);//the next comparison is O(1), unless another thread has already replaced the descriptor of other
+  return sameChannels;
+
+}
+
 template <class T, class K>
 void Histogram<T,K>::addChannel(const Bin<T>& bin){
   
   if(getDimension() ==  bin.getDimension() || getDimension() == 0)
-    countMap.emplace(bin, K{});//default construct K
+    if(countMap.emplace(bin, K{}).second) dropChannelDescriptor();//default construct K
 
 }
 
@@ -419,12 +607,75 @@ void Histogram<T,K>::addCount(const Point<T>& point){
   
 }
 
+template <class T, class K>
+template <class Iterator>
+void Histogram<T,K>::fill(Iterator firstCoordinate, Iterator lastCoordinate){
+
+  auto denseHistogram = getEmptyDenseHistogram();//locate the channels once for all the points
+  denseHistogram.fill(firstCoordinate, lastCoordinate);
+  *this += denseHistogram;
+
+}
+
+template <class T, class K>
+template <class Container>
+void Histogram<T,K>::fill(const Container& coordinates){
+
+  fill(coordinates.begin(), coordinates.end());
+
+}
+
+template <class T, class K>
+template <class Iterator, class WeightIterator>
+void Histogram<T,K>::fillWeighted(Iterator firstCoordinate, Iterator lastCoordinate, WeightIterator firstWeight){
+
+  auto denseHistogram = getEmptyDenseHistogram();
+  denseHistogram.fillWeighted(firstCoordinate, lastCoordinate, firstWeight);
+  *this += denseHistogram;
+
+}
+
+template <class T, class K>
+template <class Container, class WeightContainer>
+void Histogram<T,K>::fillWeighted(const Container& coordinates, const WeightContainer& weights){
+
+  fillWeighted(coordinates.begin(), coordinates.end(), weights.begin());
+
+}
+
+template <class T, class K>
+template <class Iterator>
+void Histogram<T,K>::fillSorted(Iterator firstValue, Iterator lastValue){
+
+  auto denseHistogram = getEmptyDenseHistogram();
+  denseHistogram.fillSorted(firstValue, lastValue);
+  *this += denseHistogram;
+
+}
+
+template <class T, class K>
+template <class Container>
+void Histogram<T,K>::fillSorted(const Container& values){
+
+  fillSorted(values.begin(), values.end());
+
+}
+
 template <class T, class K>
 void Histogram<T,K>::setCount(const Bin<T>& bin, const K& count){
 
-  countMap[bin] = count;
+  auto it = countMap.find(bin);
+  if(it != countMap.end()) it->second = count;
+  else{
+
+    countMap.emplace(bin, count);
+    dropChannelDescriptor();
+
+  }
   
 }
 
 
-#endif
\ No newline at end of file
+#include "HistogramExpression.hpp"//the arithmetic operators build lazy expressions
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef HISTOGRAM_ACCUMULATOR_H
+#define HISTOGRAM_ACCUMULATOR_H
+
+#include <iterator>
+#include "Histogram.hpp"
+#include "Parallel.hpp"
+
+template <class T, class K>
+class HistogramAccumulator{//each worker fills its own dense shadow histogram so that no lock is needed, the shadows being merged at the end
+
+  DenseHistogram<T,K> emptyHistogram;//to reset the shadows after a merge
+  std::vector<DenseHistogram<T,K>> shadows;//one per worker
+
+public:
+  HistogramAccumulator(const Binning<T>& binning, unsigned numberOfWorkers = parallel::getNumberOfThreads());
+  HistogramAccumulator(const Histogram<T,K>& histogram, unsigned numberOfWorkers = parallel::getNumberOfThreads());//use the channels of 'histogram'
+  unsigned getNumberOfWorkers() const;
+  DenseHistogram<T,K>& getShadow(unsigned worker);//must only be filled by 'worker'
+  template <class Iterator>
+  void fill(Iterator firstCoordinate, Iterator lastCoordinate);//spread the points over the workers, the iterators must be random access
+  template <class Container>
+  void fill(const Container& coordinates);
+  template <class Iterator, class WeightIterator>
+  void fillWeighted(Iterator firstCoordinate, Iterator lastCoordinate, WeightIterator firstWeight);
+  template <class Container, class WeightContainer>
+  void fillWeighted(const Container& coordinates, const WeightContainer& weights);
+  DenseHistogram<T,K> merge();//pairwise (tree) reduction of the shadows, which are then reset
+  void mergeInto(Histogram<T,K>& histogram);//add the merged counts to 'histogram'
+
+};
+
+template <class T, class K>
+HistogramAccumulator<T,K>::HistogramAccumulator(const Binning<T>& binning, unsigned numberOfWorkers):emptyHistogram(binning),shadows(std::max(numberOfWorkers, 1u), emptyHistogram){
+
+}
+
+template <class T, class K>
+HistogramAccumulator<T,K>::HistogramAccumulator(const Histogram<T,K>& histogram, unsigned numberOfWorkers):HistogramAccumulator(histogram.getEmptyDenseHistogram().getBinning(), numberOfWorkers){
+
+}
+
+template <class T, class K>
+unsigned HistogramAccumulator<T,K>::getNumberOfWorkers() const{
+
+  return shadows.size();
+
+}
+
+template <class T, class K>
+DenseHistogram<T,K>& HistogramAccumulator<T,K>::getShadow(unsigned worker){
+
+  return shadows.at(worker);
+
+}
+
+template <class T, class K>
+template <class Iterator>
+void HistogramAccumulator<T,K>::fill(Iterator firstCoordinate, Iterator lastCoordinate){
+
+  unsigned dimension = std::max(emptyHistogram.getDimension(), 1u);
+  auto numberOfPoints = std::distance(firstCoordinate, lastCoordinate) / dimension;
+
+  parallel::forEachIndex(shadows.size(), [&](unsigned worker){
+
+    auto firstPoint = worker * numberOfPoints / shadows.size();
+    auto lastPoint = (worker + 1) * numberOfPoints / shadows.size();
+    shadows[worker].fill(firstCoordinate + firstPoint * dimension, firstCoordinate + lastPoint * dimension);
+
+  });
+
+}
+
+template <class T, class K>
+template <class Container>
+void HistogramAccumulator<T,K>::fill(const Container& coordinates){
+
+  fill(coordinates.begin(), coordinates.end());
+
+}
+
+template <class T, class K>
+template <class Iterator, class WeightIterator>
+void HistogramAccumulator<T,K>::fillWeighted(Iterator firstCoordinate, Iterator lastCoordinate, WeightIterator firstWeight){
+
+  unsigned dimension = std::max(emptyHistogram.getDimension(), 1u);
+  auto numberOfPoints = std::distance(firstCoordinate, lastCoordinate) / dimension;
+
+  parallel::forEachIndex(shadows.size(), [&](unsigned worker){
+
+    auto firstPoint = worker * numberOfPoints / shadows.size();
+    auto lastPoint = (worker + 1) * numberOfPoints / shadows.size();
+    shadows[worker].fillWeighted(firstCoordinate + firstPoint * dimension, firstCoordinate + lastPoint * dimension, firstWeight + firstPoint);
+
+  });
+
+}
+
+template <class T, class K>
+template <class Container, class WeightContainer>
+void HistogramAccumulator<T,K>::fillWeighted(const Container& coordinates, const WeightContainer& weights){
+
+  fillWeighted(coordinates.begin(), coordinates.end(), weights.begin());
+
+}
+
+template <class T, class K>
+DenseHistogram<T,K> HistogramAccumulator<T,K>::merge(){
+
+  for(unsigned stride = 1; stride < shadows.size(); stride *= 2){//merge the shadows 2 by 2, each level of the tree in parallel
+
+    unsigned numberOfPairs = (shadows.size() - stride + 2 * stride - 1) / (2 * stride);
+    parallel::forEachIndex(numberOfPairs, [&](unsigned pair){shadows[2 * stride * pair] += shadows[2 * stride * pair + stride];});
+
+  }
+
+  DenseHistogram<T,K> merged{std::move(shadows.front())};
+  std::fill(shadows.begin(), shadows.end(), emptyHistogram);
+  return merged;
+
+}
+
+template <class T, class K>
+void HistogramAccumulator<T,K>::mergeInto(Histogram<T,K>& histogram){
+
+  histogram += merge();
+
+}
+
+#endif
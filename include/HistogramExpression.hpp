@@ -0,0 +1,424 @@
+#ifndef HISTOGRAM_EXPRESSION_H
+#define HISTOGRAM_EXPRESSION_H
+
+#include <type_traits>
+#include <utility>
+#include "Histogram.hpp"
+#include "Tracer.hpp"
+
+template <class Derived>
+class HistogramExpression{//lazy result of the arithmetic operators of Histogram, evaluated in a single pass over the channels when all its histograms share the same channels
+
+public:
+  const Derived& getDerived() const;
+  auto evaluate() const;//falls back on the compound operators of Histogram, one operation at a time, when the channels differ
+
+};
+
+template <class H>
+struct HistogramTraits;
+
+template <class T, class K>
+struct HistogramTraits<Histogram<T,K>>{
+
+  using BinType = T;
+  using ValueType = K;
+
+};
+
+template <class H>
+struct IsHistogram : std::false_type{};
+
+template <class T, class K>
+struct IsHistogram<Histogram<T,K>> : std::true_type{};
+
+template <class Operand>
+struct IsHistogramOperand : std::integral_constant<bool, IsHistogram<std::decay_t<Operand>>::value || std::is_base_of<HistogramExpression<std::decay_t<Operand>>, std::decay_t<Operand>>::value>{};
+
+template <class Stored>
+class HistogramTerminal : public HistogramExpression<HistogramTerminal<Stored>>{//a reference to an lvalue histogram, or a copy of a temporary one
+
+  using HistogramType = std::decay_t<Stored>;
+  Stored histogram;
+  mutable decltype(std::declval<const HistogramType&>().begin()) cursor;
+
+public:
+  using BinType = typename HistogramTraits<HistogramType>::BinType;
+  using ValueType = typename HistogramTraits<HistogramType>::ValueType;
+  HistogramTerminal(Stored histogram);
+  const HistogramType* getFirstHistogram() const;
+  template <class Function>
+  void forEachHistogram(Function function) const;
+  void start() const;
+  void advance() const;
+  const ValueType& getValue(unsigned& numberOfZeroDivisions) const;
+  const HistogramType& getOperand() const;
+  HistogramType materialise() const;
+
+};
+
+template <class Factor>
+class HistogramFactor{//a factor or divider applied to all the channels
+
+  Factor factor;
+
+public:
+  HistogramFactor(Factor factor);
+  template <class Function>
+  void forEachHistogram(Function function) const;
+  void start() const;
+  void advance() const;
+  const Factor& getValue(unsigned& numberOfZeroDivisions) const;
+  const Factor& getOperand() const;
+
+};
+
+template <class Left, class Right, class Operation>
+class HistogramBinaryExpression : public HistogramExpression<HistogramBinaryExpression<Left,Right,Operation>>{//the left operand is always a histogram expression, factors are moved to the right
+
+  Left left;
+  Right right;
+
+public:
+  using BinType = typename Left::BinType;
+  using ValueType = typename Left::ValueType;
+  HistogramBinaryExpression(Left left, Right right);
+  auto getFirstHistogram() const;
+  template <class Function>
+  void forEachHistogram(Function function) const;
+  void start() const;
+  void advance() const;
+  ValueType getValue(unsigned& numberOfZeroDivisions) const;
+  Histogram<BinType, ValueType> getOperand() const;
+  Histogram<BinType, ValueType> materialise() const;
+
+};
+
+struct HistogramAddition{
+
+  template <class ValueType, class OtherType>
+  static void apply(ValueType& value, const OtherType& other, unsigned&){value += other;}
+  template <class HistogramType, class OtherType>
+  static void applyTo(HistogramType& histogram, const OtherType& other){histogram += other;}
+
+};
+
+struct HistogramSubtraction{
+
+  template <class ValueType, class OtherType>
+  static void apply(ValueType& value, const OtherType& other, unsigned&){value -= other;}
+  template <class HistogramType, class OtherType>
+  static void applyTo(HistogramType& histogram, const OtherType& other){histogram -= other;}
+
+};
+
+struct HistogramMultiplication{
+
+  template <class ValueType, class OtherType>
+  static void apply(ValueType& value, const OtherType& other, unsigned&){value *= other;}
+  template <class HistogramType, class OtherType>
+  static void applyTo(HistogramType& histogram, const OtherType& other){histogram *= other;}
+
+};
+
+struct HistogramDivision{//channel by channel, as Histogram::operator/=(const Histogram&)
+
+  template <class ValueType, class OtherType>
+  static void apply(ValueType& value, const OtherType& other, unsigned& numberOfZeroDivisions){
+
+    if(other != ValueType{}) value /= other;
+    else ++numberOfZeroDivisions;
+
+  }
+  template <class HistogramType, class OtherType>
+  static void applyTo(HistogramType& histogram, const OtherType& other){histogram /= other;}
+
+};
+
+struct HistogramFactorDivision{//as Histogram::operator/=(const FactorType&)
+
+  template <class ValueType, class OtherType>
+  static void apply(ValueType& value, const OtherType& other, unsigned& numberOfZeroDivisions){
+
+    if(other != ValueType{}) value *= 1/other;
+    else ++numberOfZeroDivisions;
+
+  }
+  template <class HistogramType, class OtherType>
+  static void applyTo(HistogramType& histogram, const OtherType& other){histogram /= other;}
+
+};
+
+template <class Operand>
+struct HistogramNode{//expressions are kept by value, lvalue histograms by reference and temporary histograms by value
+
+  using type = std::decay_t<Operand>;
+
+};
+
+template <class T, class K>
+struct HistogramNode<Histogram<T,K>&>{
+
+  using type = HistogramTerminal<const Histogram<T,K>&>;
+
+};
+
+template <class T, class K>
+struct HistogramNode<const Histogram<T,K>&>{
+
+  using type = HistogramTerminal<const Histogram<T,K>&>;
+
+};
+
+template <class T, class K>
+struct HistogramNode<Histogram<T,K>>{
+
+  using type = HistogramTerminal<Histogram<T,K>>;
+
+};
+
+template <class T, class K>
+struct HistogramNode<const Histogram<T,K>>{
+
+  using type = HistogramTerminal<Histogram<T,K>>;
+
+};
+
+template <class Operation, class Left, class Right>
+auto makeHistogramExpression(Left&& left, Right&& right, std::true_type, std::true_type){//histogram op histogram
+
+  using LeftNode = typename HistogramNode<Left>::type;
+  using RightNode = typename HistogramNode<Right>::type;
+  return HistogramBinaryExpression<LeftNode, RightNode, Operation>(LeftNode(std::forward<Left>(left)), RightNode(std::forward<Right>(right)));
+
+}
+
+template <class Operation, class Left, class Factor>
+auto makeHistogramExpression(Left&& left, Factor&& factor, std::true_type, std::false_type){//histogram op factor
+
+  using LeftNode = typename HistogramNode<Left>::type;
+  return HistogramBinaryExpression<LeftNode, HistogramFactor<std::decay_t<Factor>>, Operation>(LeftNode(std::forward<Left>(left)), HistogramFactor<std::decay_t<Factor>>(std::forward<Factor>(factor)));
+
+}
+
+template <class Operation, class Factor, class Right>
+auto makeHistogramExpression(Factor&& factor, Right&& right, std::false_type, std::true_type){//factor * histogram is evaluated as histogram * factor
+
+  return makeHistogramExpression<Operation>(std::forward<Right>(right), std::forward<Factor>(factor), std::true_type{}, std::false_type{});
+
+}
+
+template <class Left, class Right, std::enable_if_t<IsHistogramOperand<Left>::value && IsHistogramOperand<Right>::value, int> = 0>
+auto operator+(Left&& left, Right&& right){
+
+  return makeHistogramExpression<HistogramAddition>(std::forward<Left>(left), std::forward<Right>(right), std::true_type{}, std::true_type{});
+
+}
+
+template <class Left, class Right, std::enable_if_t<IsHistogramOperand<Left>::value && IsHistogramOperand<Right>::value, int> = 0>
+auto operator-(Left&& left, Right&& right){
+
+  return makeHistogramExpression<HistogramSubtraction>(std::forward<Left>(left), std::forward<Right>(right), std::true_type{}, std::true_type{});
+
+}
+
+template <class Left, class Right, std::enable_if_t<IsHistogramOperand<Left>::value || IsHistogramOperand<Right>::value, int> = 0>
+auto operator*(Left&& left, Right&& right){
+
+  return makeHistogramExpression<HistogramMultiplication>(std::forward<Left>(left), std::forward<Right>(right), IsHistogramOperand<Left>{}, IsHistogramOperand<Right>{});
+
+}
+
+template <class Left, class Right, std::enable_if_t<IsHistogramOperand<Left>::value, int> = 0>
+auto operator/(Left&& left, Right&& right){
+
+  using Operation = std::conditional_t<IsHistogramOperand<Right>::value, HistogramDivision, HistogramFactorDivision>;
+  return makeHistogramExpression<Operation>(std::forward<Left>(left), std::forward<Right>(right), std::true_type{}, IsHistogramOperand<Right>{});
+
+}
+
+template <class Derived>
+const Derived& HistogramExpression<Derived>::getDerived() const{
+
+  return static_cast<const Derived&>(*this);
+
+}
+
+template <class Derived>
+auto HistogramExpression<Derived>::evaluate() const{
+
+  const auto& expression = getDerived();
+  const auto& reference = *expression.getFirstHistogram();
+
+  bool sameChannels = true;
+  expression.forEachHistogram([&](const auto& histogram){sameChannels = sameChannels && reference.hasSameChannelsAs(histogram);});
+  if(!sameChannels) return expression.materialise();
+
+  Histogram<typename Derived::BinType, typename Derived::ValueType> result(reference);//the channels of all the histograms, hence of the result
+  unsigned numberOfZeroDivisions{};
+  expression.start();
+  for(auto& pairBin : result){
+
+    pairBin.second = expression.getValue(numberOfZeroDivisions);
+    expression.advance();
+
+  }
+
+  if(numberOfZeroDivisions != 0) Tracer(Verbose::Warning)<<"Histogram division of "<<numberOfZeroDivisions<<" channels by "<<typename Derived::ValueType{}<<" not allowed!"<<std::endl;
+  return result;
+
+}
+
+template <class Stored>
+HistogramTerminal<Stored>::HistogramTerminal(Stored histogram):histogram(std::forward<Stored>(histogram)){
+
+}
+
+template <class Stored>
+auto HistogramTerminal<Stored>::getFirstHistogram() const -> const HistogramType*{
+
+  return &histogram;
+
+}
+
+template <class Stored>
+template <class Function>
+void HistogramTerminal<Stored>::forEachHistogram(Function function) const{
+
+  function(histogram);
+
+}
+
+template <class Stored>
+void HistogramTerminal<Stored>::start() const{
+
+  cursor = histogram.begin();
+
+}
+
+template <class Stored>
+void HistogramTerminal<Stored>::advance() const{
+
+  ++cursor;
+
+}
+
+template <class Stored>
+auto HistogramTerminal<Stored>::getValue(unsigned&) const -> const ValueType&{
+
+  return cursor->second;
+
+}
+
+template <class Stored>
+auto HistogramTerminal<Stored>::getOperand() const -> const HistogramType&{
+
+  return histogram;
+
+}
+
+template <class Stored>
+auto HistogramTerminal<Stored>::materialise() const -> HistogramType{
+
+  return histogram;
+
+}
+
+template <class Factor>
+HistogramFactor<Factor>::HistogramFactor(Factor factor):factor(std::move(factor)){
+
+}
+
+template <class Factor>
+template <class Function>
+void HistogramFactor<Factor>::forEachHistogram(Function) const{
+
+}
+
+template <class Factor>
+void HistogramFactor<Factor>::start() const{
+
+}
+
+template <class Factor>
+void HistogramFactor<Factor>::advance() const{
+
+}
+
+template <class Factor>
+const Factor& HistogramFactor<Factor>::getValue(unsigned&) const{
+
+  return factor;
+
+}
+
+template <class Factor>
+const Factor& HistogramFactor<Factor>::getOperand() const{
+
+  return factor;
+
+}
+
+template <class Left, class Right, class Operation>
+HistogramBinaryExpression<Left,Right,Operation>::HistogramBinaryExpression(Left left, Right right):left(std::move(left)),right(std::move(right)){
+
+}
+
+template <class Left, class Right, class Operation>
+auto HistogramBinaryExpression<Left,Right,Operation>::getFirstHistogram() const{
+
+  return left.getFirstHistogram();
+
+}
+
+template <class Left, class Right, class Operation>
+template <class Function>
+void HistogramBinaryExpression<Left,Right,Operation>::forEachHistogram(Function function) const{
+
+  left.forEachHistogram(function);
+  right.forEachHistogram(function);
+
+}
+
+template <class Left, class Right, class Operation>
+void HistogramBinaryExpression<Left,Right,Operation>::start() const{
+
+  left.start();
+  right.start();
+
+}
+
+template <class Left, class Right, class Operation>
+void HistogramBinaryExpression<Left,Right,Operation>::advance() const{
+
+  left.advance();
+  right.advance();
+
+}
+
+template <class Left, class Right, class Operation>
+auto HistogramBinaryExpression<Left,Right,Operation>::getValue(unsigned& numberOfZeroDivisions) const -> ValueType{
+
+  ValueType value = left.getValue(numberOfZeroDivisions);
+  Operation::apply(value, right.getValue(numberOfZeroDivisions), numberOfZeroDivisions);
+  return value;
+
+}
+
+template <class Left, class Right, class Operation>
+auto HistogramBinaryExpression<Left,Right,Operation>::getOperand() const -> Histogram<BinType, ValueType>{
+
+  return materialise();
+
+}
+
+template <class Left, class Right, class Operation>
+auto HistogramBinaryExpression<Left,Right,Operation>::materialise() const -> Histogram<BinType, ValueType>{
+
+  auto histogram = left.materialise();
+  Operation::applyTo(histogram, right.getOperand());
+  return histogram;
+
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <atomic>
+#include <future>
+#include <vector>
+#include <algorithm>
+
+namespace parallel{
+  
+  void setNumberOfThreads(unsigned numberOfThreads);//0 to use all the hardware threads
+  unsigned getNumberOfThreads();
+  template <class Function>
+  void forEachIndex(unsigned size, Function function);//calls function(k) for k in [0, size[, each thread handling a contiguous block of indices
+  
+  template <class Function>
+  void forEachIndex(unsigned size, Function function){
+    
+    unsigned numberOfBlocks = std::min(getNumberOfThreads(), size);
+    if(numberOfBlocks < 2){
+      
+      for(unsigned k = 0; k < size; ++k) function(k);
+      return;
+      
+    }
+    
+    auto processBlock = [&](unsigned block){
+      
+      for(unsigned k = block * size / numberOfBlocks; k < (block + 1) * size / numberOfBlocks; ++k) function(k);
+      
+    };
+    
+    std::vector<std::future<void>> futures;
+    for(unsigned block = 1; block < numberOfBlocks; ++block) futures.emplace_back(std::async(std::launch::async, processBlock, block));
+    processBlock(0);//the calling thread handles the first block
+    for(auto& future : futures) future.get();//rethrows the exceptions of the workers
+    
+  }
+  
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef PARAMETER_SCAN_H
+#define PARAMETER_SCAN_H
+
+#include "Simulation.hpp"
+#include "Binning.hpp"
+#include "Parallel.hpp"
+
+template <class T, class K>
+class ParameterScan{//chi square between the data spectra of an experiment and the spectra simulated for its configurations, over a grid of (theta13, delta31)
+
+  double averageDistance;
+  std::vector<double> energies;//center of the energy channels of the reference spectra, where the oscillation is evaluated
+  std::vector<std::vector<K>> weighedSpectra;//reference spectra weighed with the composition of each configuration and multiplied by the cross section
+  std::vector<K> rates;//data rate of each configuration, to which the simulated spectra are scaled
+  std::vector<std::vector<K>> dataValues;//scaled data spectra on the (shifted) energy channels of the reference spectra
+  std::vector<std::vector<K>> dataVariances;
+
+public:
+  template <class ConfigurationType, class RunType>
+  ParameterScan(const Experiment<ConfigurationType, RunType>& experiment, Simulation<T,K> simulation, const T& energyShift = T{});//energyShift is applied to the simulated channels before comparing them to the data, as with Simulation::shiftResultingSpectra
+  unsigned getNumberOfConfigurations() const;
+  unsigned getNumberOfEnergyChannels() const;
+  K getChiSquare(double theta13, double delta31) const;
+  std::vector<K> getChiSquares(const std::vector<Point<double>>& parameters) const;//for a list of (theta13, delta31), computed in parallel
+  Histogram<double, K> scan(const Axis<double>& theta13Axis, const Axis<double>& delta31Axis) const;//chi square at the center of each cell of the grid
+
+};
+
+template <class T, class K>
+template <class ConfigurationType, class RunType>
+ParameterScan<T,K>::ParameterScan(const Experiment<ConfigurationType, RunType>& experiment, Simulation<T,K> simulation, const T& energyShift):averageDistance(simulation.getAverageDistance()){
+
+  simulation.buildFrom(experiment);//weighed reference spectra, without oscillation nor cross section
+  if(simulation.getResults().empty()) return;
+
+  std::vector<Bin<T>> dataChannels;
+  for(const auto& pairBin : simulation.getResults().begin()->second){//the results share the channels of the reference spectra
+
+    energies.emplace_back(pairBin.first.getEdge(0).getCenter());
+    dataChannels.emplace_back(shift(pairBin.first, Point<T>(energyShift)));
+
+  }
+
+  std::vector<double> crossSections(energies.size());
+  constants::crossSection(energies.data(), crossSections.data(), energies.size());//does not depend on the scanned parameters
+
+  auto dataSpectra = experiment.template getScaledNeutrinoSpectra<T, Scalar<K>>(dataChannels);
+  for(const auto& pairRun : experiment){
+
+    rates.emplace_back(pairRun.second.template getNeutrinoRate<K>(experiment.getDistance1(), experiment.getDistance2(), experiment.getBackgroundRate()));
+
+    weighedSpectra.emplace_back();
+    for(const auto& pairBin : simulation.getResults().at(pairRun.first)) weighedSpectra.back().emplace_back(pairBin.second * crossSections[weighedSpectra.back().size()]);
+
+    dataValues.emplace_back();
+    dataVariances.emplace_back();
+    const auto& dataSpectrum = dataSpectra.at(pairRun.first);
+    for(const auto& channel : dataChannels){
+
+      auto count = dataSpectrum.getCount(channel.getCenter());
+      dataValues.back().emplace_back(count.getValue());
+      dataVariances.back().emplace_back(count.getVariance());
+
+    }
+
+  }
+
+}
+
+template <class T, class K>
+unsigned ParameterScan<T,K>::getNumberOfConfigurations() const{
+
+  return rates.size();
+
+}
+
+template <class T, class K>
+unsigned ParameterScan<T,K>::getNumberOfEnergyChannels() const{
+
+  return energies.size();
+
+}
+
+template <class T, class K>
+K ParameterScan<T,K>::getChiSquare(double theta13, double delta31) const{
+
+  std::vector<double> survivalProbabilities(energies.size());
+  constants::oscillation(energies.data(), survivalProbabilities.data(), energies.size(), averageDistance, theta13, delta31);//the only factor depending on the parameters
+
+  K chiSquare{};
+  for(unsigned c = 0; c < rates.size(); ++c){
+
+    K totalCounts{};
+    for(unsigned j = 0; j < energies.size(); ++j) totalCounts += weighedSpectra[c][j] * survivalProbabilities[j];
+    if(totalCounts == K{}) continue;
+
+    K norm = rates[c] / totalCounts;//same normalisation as Simulation::scaleCountsTo
+    for(unsigned j = 0; j < energies.size(); ++j){
+
+      if(!(dataVariances[c][j] > K{})) continue;//channels without data do not constrain the parameters
+      K residual = dataValues[c][j] - norm * weighedSpectra[c][j] * survivalProbabilities[j];
+      chiSquare += residual * residual / dataVariances[c][j];
+
+    }
+
+  }
+
+  return chiSquare;
+
+}
+
+template <class T, class K>
+std::vector<K> ParameterScan<T,K>::getChiSquares(const std::vector<Point<double>>& parameters) const{
+
+  std::vector<K> chiSquares(parameters.size());
+  parallel::forEachIndex(parameters.size(), [&](unsigned k){chiSquares[k] = getChiSquare(parameters[k].getCoordinate(0), parameters[k].getCoordinate(1));});
+  return chiSquares;
+
+}
+
+template <class T, class K>
+Histogram<double, K> ParameterScan<T,K>::scan(const Axis<double>& theta13Axis, const Axis<double>& delta31Axis) const{
+
+  Binning<double> grid(std::vector<Axis<double>>{theta13Axis, delta31Axis});
+
+  std::vector<Point<double>> parameters;
+  for(const auto& channel : grid.getChannels()) parameters.emplace_back(channel.getCenter());
+  auto chiSquares = getChiSquares(parameters);
+
+  Histogram<double, K> surface;
+  for(unsigned k = 0; k < grid.getNumberOfChannels(); ++k) surface.setCount(grid.getChannel(k), chiSquares[k]);
+  return surface;
+
+}
+
+#endif
@@ -5,21 +5,22 @@
 #include <stdexcept> 
 #include <iostream>
 #include <iomanip>
+#include "SmallVector.hpp"
 
 template <class T>
 class Point{
   
-  std::vector<T> coordinates;
+  SmallVector<T,4> coordinates;//up to 4 coordinates (such as a fuel composition) are stored inline, without allocation
 public:
   Point() = default;
   Point(const T& coordinate);//constructor for 1D points
   template <class Iterator>
   Point(Iterator firstCoordinate, Iterator lastCoordinate);
   Point(std::initializer_list<T> coordinates);
-  typename std::vector<T>::const_iterator begin() const;
-  typename std::vector<T>::const_iterator end() const;
-  typename std::vector<T>::iterator begin();
-  typename std::vector<T>::iterator end();
+  typename SmallVector<T,4>::const_iterator begin() const;
+  typename SmallVector<T,4>::const_iterator end() const;
+  typename SmallVector<T,4>::iterator begin();
+  typename SmallVector<T,4>::iterator end();
   const T& getCoordinate(unsigned k) const;
   unsigned getDimension() const;
   void setCoordinate(unsigned k, const T& coordinate);
@@ -73,28 +74,28 @@ Point<T>::Point(std::initializer_list<T> coordinates):Point(coordinates.begin(),
 }
 
 template <class T>
-typename std::vector<T>::const_iterator Point<T>::begin() const{
+typename SmallVector<T,4>::const_iterator Point<T>::begin() const{
   
   return coordinates.begin();
 
 }
 
 template <class T>
-typename std::vector<T>::const_iterator Point<T>::end() const{
+typename SmallVector<T,4>::const_iterator Point<T>::end() const{
   
   return coordinates.end();
 
 }
 
 template <class T>
-typename std::vector<T>::iterator Point<T>::begin(){
+typename SmallVector<T,4>::iterator Point<T>::begin(){
   
   return coordinates.begin();
 
 }
 
 template <class T>
-typename std::vector<T>::iterator Point<T>::end(){
+typename SmallVector<T,4>::iterator Point<T>::end(){
   
   return coordinates.end();
 
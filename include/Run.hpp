@@ -5,13 +5,14 @@
 #include <iostream>
 #include <cmath>
 #include <limits>
+#include <algorithm>
 #include "Particle.hpp"
 #include "Histogram.hpp"
 
 template <class T>
 class Run{
 
-  std::vector<Particle> neutrinos;//neutrinos detected during the run
+  std::vector<T> energies;//energies of the neutrinos detected during the run, sorted so that spectra can be built with binary searches
   T time;// lenght of the run
   T spentEnergy1;//energy spent by reactor 1 during the run
   T spentEnergy2;//energy spent by reactor 2 during the run
@@ -22,11 +23,16 @@ class Run{
   template <class BinType, class ValueType>
   struct HistogramTypes{};//to specialise some methods for <BinType, Scalar<ValueType>>
   
+  static T getEnergy(const Particle& neutrino);
+  template <class Value>
+  static T getEnergy(const Value& energy);
   template <class ReturnType>
   ReturnType getNeutrinoRate(NeutrinoType<ReturnType>, T distance1, T distance2, T backgroundRate) const;
   template <class ReturnType>
   Scalar<ReturnType> getNeutrinoRate(NeutrinoType<Scalar<ReturnType>>, T distance1, T distance2, T backgroundRate) const;
   template<class BinType, class ValueType, class Iterator>
+  DenseHistogram<BinType, ValueType> getDenseNeutrinoSpectrum(Iterator firstBin, Iterator lastBin) const;//the counts are scaled in their contiguous storage before being converted to a Histogram
+  template<class BinType, class ValueType, class Iterator>
   Histogram<BinType, ValueType> getScaledNeutrinoSpectrum(HistogramTypes<BinType,ValueType>, T distance1, T distance2, T backgroundRate, Iterator firstBin, Iterator lastBin) const;
   template<class BinType, class ValueType, class Iterator>
   Histogram<BinType, Scalar<ValueType>> getScaledNeutrinoSpectrum(HistogramTypes<BinType,Scalar<ValueType>>, T distance1, T distance2, T backgroundRate, Iterator firstBin, Iterator lastBin) const;
@@ -34,12 +40,14 @@ class Run{
 public:  
   Run();
   template <class Iterator>
-  Run(Iterator beginNeutrino, Iterator endNeutrino, T time, T power1, T power2);//the energy is filled as power*time
+  Run(Iterator beginNeutrino, Iterator endNeutrino, T time, T power1, T power2);//the energy is filled as power*time, the neutrinos are either Particle's or energies
   template <class Container>
   Run(const Container& neutrinos, T time, T power1, T power2);//for iterable containters
   Run<T>& operator+=(const Run<T>& other);
+  Run<T>& operator+=(Run<T>&& other);//reuses the storage of the larger of the two runs
   bool operator==(const Run<T>& other) const;
   unsigned getNumberOfCandidates() const;
+  const std::vector<T>& getEnergies() const;
   T getRunningTime() const;
   T getSpentEnergy1() const;
   T getSpentEnergy2() const;
@@ -73,7 +81,7 @@ template <class ReturnType>
 ReturnType Run<T>::getNeutrinoRate(NeutrinoType<ReturnType>, T distance1, T distance2, T backgroundRate) const{
   
   ReturnType meanSpentEnergy = getMeanSpentEnergy(distance1, distance2);
-  ReturnType numberOfNeutrinos = neutrinos.size() - backgroundRate * time;
+  ReturnType numberOfNeutrinos = energies.size() - backgroundRate * time;
 
   ReturnType zero{};
   if(meanSpentEnergy > zero && numberOfNeutrinos > zero) return numberOfNeutrinos/meanSpentEnergy;
@@ -86,7 +94,7 @@ template <class ReturnType>
 Scalar<ReturnType> Run<T>::getNeutrinoRate(NeutrinoType<Scalar<ReturnType>>, T distance1, T distance2, T backgroundRate) const{
   
   Scalar<ReturnType> meanSpentEnergy = getMeanSpentEnergy(distance1, distance2);
-  Scalar<ReturnType> numberOfNeutrinos{neutrinos.size() - backgroundRate * time, neutrinos.size()};//assume no error on the background yet
+  Scalar<ReturnType> numberOfNeutrinos{energies.size() - backgroundRate * time, energies.size()};//assume no error on the background yet
 
   Scalar<ReturnType> zero{};
   if(meanSpentEnergy > zero && numberOfNeutrinos > zero) return numberOfNeutrinos/meanSpentEnergy;
@@ -98,8 +106,8 @@ template <class T>
 template<class BinType, class ValueType, class Iterator>
 Histogram<BinType, ValueType> Run<T>::getScaledNeutrinoSpectrum(HistogramTypes<BinType,ValueType>, T distance1, T distance2, T backgroundRate, Iterator firstBin, Iterator lastBin) const{
 
-  auto histogram = getNeutrinoSpectrum<BinType, ValueType>(firstBin, lastBin);
-  return histogram.scaleCountsTo(getNeutrinoRate<ValueType>(distance1, distance2, backgroundRate));
+  auto histogram = getDenseNeutrinoSpectrum<BinType, ValueType>(firstBin, lastBin);
+  return Histogram<BinType, ValueType>(histogram.scaleCountsTo(getNeutrinoRate<ValueType>(distance1, distance2, backgroundRate)));
   
 }
 
@@ -107,19 +115,37 @@ template <class T>
 template<class BinType, class ValueType, class Iterator>
 Histogram<BinType,Scalar<ValueType>> Run<T>::getScaledNeutrinoSpectrum(HistogramTypes<BinType,Scalar<ValueType>>, T distance1, T distance2, T backgroundRate, Iterator firstBin, Iterator lastBin) const{
 
-  auto histogram = getNeutrinoSpectrum<BinType,Scalar<ValueType>>(firstBin, lastBin);
-  return histogram.scaleCountsTo(getNeutrinoRate<ValueType>(distance1, distance2, backgroundRate));//drop the "Scalar" when normalising since we don't want to double count the error on the bin contents
+  auto histogram = getDenseNeutrinoSpectrum<BinType,Scalar<ValueType>>(firstBin, lastBin);
+  return Histogram<BinType,Scalar<ValueType>>(histogram.scaleCountsTo(getNeutrinoRate<ValueType>(distance1, distance2, backgroundRate)));//vectorised over the values and variances, drop the "Scalar" when normalising since we don't want to double count the error on the bin contents
+  
+}
+
+template <class T>
+T Run<T>::getEnergy(const Particle& neutrino){
+  
+  return neutrino.getEnergy();
+  
+}
+
+template <class T>
+template <class Value>
+T Run<T>::getEnergy(const Value& energy){
+  
+  return energy;
   
 }
 
 template <class T>
-Run<T>::Run():neutrinos(T{}),time(T{}),spentEnergy1(T{}),spentEnergy2(T{}){
+Run<T>::Run():time(T{}),spentEnergy1(T{}),spentEnergy2(T{}){
   
 }
 
 template <class T>
 template <class Iterator>
-Run<T>::Run(Iterator beginNeutrino, Iterator endNeutrino, T time, T power1, T power2):neutrinos(beginNeutrino,endNeutrino),time(time),spentEnergy1(power1*time),spentEnergy2(power2*time){
+Run<T>::Run(Iterator beginNeutrino, Iterator endNeutrino, T time, T power1, T power2):time(time),spentEnergy1(power1*time),spentEnergy2(power2*time){
+  
+  for(auto it = beginNeutrino; it != endNeutrino; ++it) energies.emplace_back(getEnergy(*it));
+  if(!std::is_sorted(energies.begin(), energies.end())) std::sort(energies.begin(), energies.end());
   
 }
 
@@ -139,7 +165,8 @@ Run<T> operator+(Run<T> run1, const Run<T>& run2){
 template <class T>
 Run<T>& Run<T>::operator+=(const Run<T>& other){
   
-  neutrinos.insert(neutrinos.end(), other.neutrinos.begin(), other.neutrinos.end());
+  auto itOther = energies.insert(energies.end(), other.energies.begin(), other.energies.end());
+  std::inplace_merge(energies.begin(), itOther, energies.end());//keep the energies sorted
   time += other.time;
   spentEnergy1 += other.spentEnergy1;
   spentEnergy2 += other.spentEnergy2;
@@ -148,13 +175,19 @@ Run<T>& Run<T>::operator+=(const Run<T>& other){
 
 }
 
+template <class T>
+Run<T>& Run<T>::operator+=(Run<T>&& other){
+  
+  if(other.energies.capacity() > energies.capacity()) energies.swap(other.energies);//append the smaller set of energies to the larger buffer
+  return *this += other;
+
+}
+
 template <class T>
 bool Run<T>::operator==(const Run<T>& other) const{
   
-  for(auto it = std::make_pair(neutrinos.begin(), other.neutrinos.begin()); it.first != neutrinos.end() && it.second != other.neutrinos.end(); ++it.first, ++it.second)
-    if(it.first->getEnergy() != it.second->getEnergy()) return false;
-    
-  if(time != other.time) return false;
+  if(energies != other.energies) return false;
+  else if(time != other.time) return false;
   else if(spentEnergy1 != other.spentEnergy1) return false;  
   else if(spentEnergy2 != other.spentEnergy2) return false;
   else return true;
@@ -164,7 +197,14 @@ bool Run<T>::operator==(const Run<T>& other) const{
 template <class T>
 unsigned Run<T>::getNumberOfCandidates() const{
   
-  return neutrinos.size();
+  return energies.size();
+
+}
+
+template <class T>
+const std::vector<T>& Run<T>::getEnergies() const{
+  
+  return energies;
 
 }
 
@@ -206,14 +246,25 @@ ReturnType Run<T>::getNeutrinoRate(T distance1, T distance2, T backgroundRate) c
 
 template <class T>
 template<class BinType, class ValueType, class Iterator>
-Histogram<BinType, ValueType> Run<T>::getNeutrinoSpectrum(Iterator firstBin, Iterator lastBin) const{
+DenseHistogram<BinType, ValueType> Run<T>::getDenseNeutrinoSpectrum(Iterator firstBin, Iterator lastBin) const{
 
-  Histogram<BinType, ValueType> histogram(firstBin, lastBin);
-  for(const auto& neutrino : neutrinos) histogram.addCount(Point<BinType>{neutrino.getEnergy()});
+  DenseHistogram<BinType, ValueType> histogram(firstBin, lastBin);//locate the channels through index arithmetic rather than scanning all the bins
+  
+  if(histogram.getDimension() == 1) histogram.fillSorted(energies);//O(B log N) since the energies are already sorted
+  else if(histogram.getDimension() > 1) Tracer(Verbose::Error)<<"Neutrino spectra need 1-D energy channels, not "<<histogram.getDimension()<<"-D ones => Spectrum left empty"<<std::endl;//a neutrino is one energy, not a point of the binning
+  
   return histogram;
   
 }
 
+template <class T>
+template<class BinType, class ValueType, class Iterator>
+Histogram<BinType, ValueType> Run<T>::getNeutrinoSpectrum(Iterator firstBin, Iterator lastBin) const{
+
+  return Histogram<BinType, ValueType>(getDenseNeutrinoSpectrum<BinType, ValueType>(firstBin, lastBin));
+  
+}
+
 template <class T>
 template<class BinType, class ValueType, class Container>
 Histogram<BinType, ValueType> Run<T>::getNeutrinoSpectrum(const Container& bins) const{
@@ -0,0 +1,115 @@
+#ifndef RUN_TABLE_H
+#define RUN_TABLE_H
+
+#include <array>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "Experiment.hpp"
+#include "Reactor.hpp"
+#include "Parallel.hpp"
+
+class RunTable{//columnar copy of the runs read from the data and simulation trees, which can be saved to and read back from a binary file
+
+  std::vector<int> runNumbers;
+  std::vector<double> runLengths;//in days
+  std::vector<double> powers1, powers2;//in GW
+  std::array<std::vector<double>, 4> fissions1, fissions2;//number of fissions of 235U, 238U, 239Pu and 241Pu in each reactor
+  std::vector<std::uint64_t> energyOffsets;//the energies of run k are in [energyOffsets[k], energyOffsets[k+1][
+  std::vector<double> energies;//energies of the neutrinos of all runs, run after run
+  template <class T, class K>
+  void addRuns(Experiment<T,K>& experiment, unsigned firstRun, unsigned lastRun) const;//add the runs in [firstRun, lastRun[ to their configuration
+
+public:
+  RunTable();
+  template <class Iterator>
+  void addRun(int runNumber, double runLength, double power1, double power2, const std::array<double, 4>& runFissions1, const std::array<double, 4>& runFissions2, Iterator firstEnergy, Iterator lastEnergy);
+  void clear();
+  unsigned getNumberOfRuns() const;
+  std::uint64_t getNumberOfNeutrinos() const;
+  int getRunNumber(unsigned k) const;
+  double getRunLength(unsigned k) const;
+  double getPower1(unsigned k) const;
+  double getPower2(unsigned k) const;
+  Fuel getFuel1(unsigned k) const;
+  Fuel getFuel2(unsigned k) const;
+  std::array<double, 4> getFissions1(unsigned k) const;
+  std::array<double, 4> getFissions2(unsigned k) const;
+  std::vector<double>::const_iterator getFirstEnergy(unsigned k) const;
+  std::vector<double>::const_iterator getLastEnergy(unsigned k) const;
+  template <class T, class K, class Iterator>
+  Experiment<T,K> getExperiment(double distance1, double distance2, double backgroundRate, Iterator beginChannel, Iterator endChannel) const;//the runs are split in chunks added in parallel
+  template <class T, class K, class Container>
+  Experiment<T,K> getExperiment(double distance1, double distance2, double backgroundRate, const Container& channels) const;
+  bool save(const std::string& path, const std::string& sources = "") const;//write the description of the inputs, then the columns one after the other in native byte order
+  bool load(const std::string& path, const std::string& sources = "");//read a file written by save directly into the columns, returns false and leaves the table empty if the file cannot be used or was saved with other sources
+
+};
+
+template <class Iterator>
+void RunTable::addRun(int runNumber, double runLength, double power1, double power2, const std::array<double, 4>& runFissions1, const std::array<double, 4>& runFissions2, Iterator firstEnergy, Iterator lastEnergy){
+
+  runNumbers.emplace_back(runNumber);
+  runLengths.emplace_back(runLength);
+  powers1.emplace_back(power1);
+  powers2.emplace_back(power2);
+  for(unsigned i = 0; i < 4; ++i){
+
+    fissions1[i].emplace_back(runFissions1[i]);
+    fissions2[i].emplace_back(runFissions2[i]);
+
+  }
+
+  energies.insert(energies.end(), firstEnergy, lastEnergy);
+  energyOffsets.emplace_back(energies.size());
+
+}
+
+template <class T, class K>
+void RunTable::addRuns(Experiment<T,K>& experiment, unsigned firstRun, unsigned lastRun) const{
+
+  Reactor reactor1, reactor2;
+  reactor1.setDistanceToDetector(experiment.getDistance1());
+  reactor2.setDistanceToDetector(experiment.getDistance2());
+  Fuel equivalentFuel;
+
+  for(unsigned k = firstRun; k < lastRun; ++k){
+
+    reactor1.setPower(powers1[k]);
+    reactor1.setFuel(getFuel1(k));
+    reactor2.setPower(powers2[k]);
+    reactor2.setFuel(getFuel2(k));
+    equivalentFuel = (reactor1 + reactor2).getFuel();
+
+    experiment.addRun(
+      Point<T>{equivalentFuel.getFrac("235U"), equivalentFuel.getFrac("238U"), equivalentFuel.getFrac("239Pu"), equivalentFuel.getFrac("241Pu")},
+      Run<K>(getFirstEnergy(k), getLastEnergy(k), runLengths[k], powers1[k], powers2[k])
+    );
+
+  }
+
+}
+
+template <class T, class K, class Iterator>
+Experiment<T,K> RunTable::getExperiment(double distance1, double distance2, double backgroundRate, Iterator beginChannel, Iterator endChannel) const{
+
+  Experiment<T,K> emptyExperiment(distance1, distance2, backgroundRate);
+  emptyExperiment.addChannels(beginChannel, endChannel);
+
+  unsigned numberOfChunks = std::max(std::min(parallel::getNumberOfThreads(), getNumberOfRuns()), 1u);
+  std::vector<Experiment<T,K>> partialExperiments(numberOfChunks, emptyExperiment);//each chunk of runs fills its own experiment
+  parallel::forEachIndex(numberOfChunks, [&](unsigned chunk){addRuns(partialExperiments[chunk], chunk * getNumberOfRuns() / numberOfChunks, (chunk + 1) * getNumberOfRuns() / numberOfChunks);});
+
+  for(unsigned chunk = 1; chunk < numberOfChunks; ++chunk) partialExperiments.front() += std::move(partialExperiments[chunk]);//merge the partial experiments channel by channel
+  return partialExperiments.front();
+
+}
+
+template <class T, class K, class Container>
+Experiment<T,K> RunTable::getExperiment(double distance1, double distance2, double backgroundRate, const Container& channels) const{
+
+  return getExperiment<T,K>(distance1, distance2, backgroundRate, channels.begin(), channels.end());
+
+}
+
+#endif
@@ -3,13 +3,17 @@
 
 #include <iomanip>
 #include <cmath>
+#include <atomic>
+#include <cstdint>
 #include "Tracer.hpp"
 
 template <class T>
 class Scalar{
 
-  static std::atomic<unsigned> globalIdentifier;//thread-safe counter
-  int identifier;//to compare for equality when computing Var with X = Y, can be negative after having multiplied by a negative-valued Scalar
+  static const std::int64_t identifierBlockSize = 1<<12;
+  static std::atomic<std::int64_t> nextIdentifierBlock;//first identifier of the next block handed to a thread
+  static std::int64_t getNewIdentifier();//taken from a block owned by the calling thread, so that threads only share the counter once per block
+  std::int64_t identifier;//to compare for equality when computing Var with X = Y, can be negative after having multiplied by a negative-valued Scalar
   T value;//value of the scalar
   T variance;//square of the 1 sigma error on the 'value'
   
@@ -48,7 +52,7 @@ public:
 };
 
 template <class T>
-std::atomic<unsigned> Scalar<T>::globalIdentifier{};//allocate space and assign to default (zero) value
+std::atomic<std::int64_t> Scalar<T>::nextIdentifierBlock{1};//0 is left to default-constructed scalars
 
 template <class T>
 std::ostream& operator<<(std::ostream& output, const Scalar<T>& scalar){
@@ -152,15 +156,30 @@ auto covariance(const Scalar<T>& scalar1, const Scalar<T>& scalar2){
   
 }
 
+template <class T>
+std::int64_t Scalar<T>::getNewIdentifier(){
+
+  thread_local std::int64_t nextIdentifier{}, lastIdentifier{};//identifiers in [nextIdentifier, lastIdentifier[ belong to this thread
+  if(nextIdentifier == lastIdentifier){
+
+    nextIdentifier = nextIdentifierBlock.fetch_add(identifierBlockSize, std::memory_order_relaxed);//64 bits do not wrap in practice
+    lastIdentifier = nextIdentifier + identifierBlockSize;
+
+  }
+
+  return nextIdentifier++;
+
+}
+
 template <class T>
 template <class K>
-Scalar<T>::Scalar(K value):identifier(++globalIdentifier),value(value),variance(T{}){
+Scalar<T>::Scalar(K value):identifier(getNewIdentifier()),value(value),variance(T{}){
   
 }
 
 template <class T>
 template <class K1, class K2>
-Scalar<T>::Scalar(K1 value, K2 variance):identifier(++globalIdentifier),value(value),variance(variance){
+Scalar<T>::Scalar(K1 value, K2 variance):identifier(getNewIdentifier()),value(value),variance(variance){
   
 }
 
@@ -186,7 +205,7 @@ Scalar<T>& Scalar<T>::operator+=(const Scalar<T>& other){
 
   variance += other.variance + 2 * getCovarianceWith(other);//Var(Y) + 2 Cov(X,Y)
   value += other.value;
-  if(identifier != other.identifier && identifier != -other.identifier) identifier = ++globalIdentifier;//when adding another variable, assume that X+Y is now independent enough from X and from Y(for lack of an efficient alternative)
+  if(identifier != other.identifier && identifier != -other.identifier) identifier = getNewIdentifier();//when adding another variable, assume that X+Y is now independent enough from X and from Y(for lack of an efficient alternative)
   
   return *this;
 
@@ -197,7 +216,7 @@ Scalar<T>& Scalar<T>::operator-=(const Scalar<T>& other){
 
   variance += other.variance - 2 * getCovarianceWith(other);//Var(Y) - 2 Cov(X,Y)
   value -= other.value;
-  if(identifier != other.identifier && identifier != -other.identifier) identifier = ++globalIdentifier;//when adding another variable, assume that X+Y is now independent enough from X and from Y(for lack of an efficient alternative)
+  if(identifier != other.identifier && identifier != -other.identifier) identifier = getNewIdentifier();//when adding another variable, assume that X+Y is now independent enough from X and from Y(for lack of an efficient alternative)
   
   return *this;
 
@@ -217,7 +236,7 @@ Scalar<T>& Scalar<T>::operator*=(const Scalar<T>& other){
   value = value * other.value + covariance;
   
   if(identifier == -other.identifier || (other.variance == T{} && value * other.value < T{}) ) identifier = -identifier; //if mulitplying by a scalar of opposite sign, assume anti-correlation
-  else identifier = ++globalIdentifier;//when multiplying by another variable, assume that XY is now independent enough from X and from Y
+  else identifier = getNewIdentifier();//when multiplying by another variable, assume that XY is now independent enough from X and from Y
   
   return *this;
 
@@ -235,7 +254,7 @@ Scalar<T>& Scalar<T>::operator/=(const Scalar<T>& other){
     value = value / other.value - covariance/std::pow(other.value,2) + value * other.variance / std::pow(other.value, 3);//second order Taylor expansion approximation of E(X/Y)
     
     if(identifier == -other.identifier || (other.variance == T{} && value * other.value < T{}) ) identifier = -identifier; //if dividing by a scalar of opposite sign, assume anti-correlation
-    else identifier = ++globalIdentifier;//when dividing by another variable, assume that X/Y is now independent enough from X and from Y
+    else identifier = getNewIdentifier();//when dividing by another variable, assume that X/Y is now independent enough from X and from Y
     
   }
   else Tracer(Verbose::Warning)<<"Scalar division by "<<zero<<" not allowed!"<<std::endl;
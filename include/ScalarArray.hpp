@@ -0,0 +1,402 @@
+#ifndef SCALAR_ARRAY_H
+#define SCALAR_ARRAY_H
+
+#include <vector>
+#include "Scalar.hpp"
+#include "Tracer.hpp"
+
+template <class T>
+class ScalarArray{//values and variances of uncorrelated Scalar<T>'s in two contiguous arrays, so that bulk operations are vectorised loops instead of Scalar operations
+
+  std::vector<T> values;
+  std::vector<T> variances;
+
+public:
+  class Reference{//proxy to one element, read and written as a Scalar<T>
+
+    ScalarArray<T>& array;
+    unsigned k;
+
+  public:
+    Reference(ScalarArray<T>& array, unsigned k);
+    operator Scalar<T>() const;
+    Reference& operator=(const Scalar<T>& scalar);
+    Reference& operator+=(const Scalar<T>& scalar);//the elements carry no identifier, so the scalar is assumed uncorrelated to them
+    Reference& operator+=(const Reference& other);//without going through a Scalar<T>
+
+  };
+
+  ScalarArray() = default;
+  ScalarArray(unsigned size, const Scalar<T>& scalar = Scalar<T>{});
+  template <class Iterator>
+  ScalarArray(Iterator firstScalar, Iterator lastScalar);
+  unsigned size() const;
+  Reference operator[](unsigned k);
+  Scalar<T> operator[](unsigned k) const;
+  Reference at(unsigned k);
+  Scalar<T> at(unsigned k) const;
+  std::vector<T>& getValues();
+  const std::vector<T>& getValues() const;
+  std::vector<T>& getVariances();
+  const std::vector<T>& getVariances() const;
+  Scalar<T> getTotal() const;
+  std::vector<Scalar<T>> toScalars() const;//to fall back on the identifier-based correlations of Scalar
+  ScalarArray<T>& operator*=(const T& factor);
+  ScalarArray<T>& operator*=(const Scalar<T>& factor);
+  ScalarArray<T>& operator/=(const T& divider);
+  ScalarArray<T>& operator/=(const Scalar<T>& divider);
+  ScalarArray<T>& operator+=(const ScalarArray<T>& other);//element by element, with uncorrelated errors
+  ScalarArray<T>& operator-=(const ScalarArray<T>& other);
+  ScalarArray<T>& operator*=(const ScalarArray<T>& other);
+  ScalarArray<T>& operator/=(const ScalarArray<T>& other);//elements divided by zero are left unchanged
+
+};
+
+template <class K>
+struct CountStore{//contiguous storage of the counts of a dense histogram
+
+  using type = std::vector<K>;
+
+};
+
+template <class T>
+struct CountStore<Scalar<T>>{
+
+  using type = ScalarArray<T>;
+
+};
+
+template <class T>
+ScalarArray<T>::Reference::Reference(ScalarArray<T>& array, unsigned k):array(array),k(k){
+
+}
+
+template <class T>
+ScalarArray<T>::Reference::operator Scalar<T>() const{
+
+  return Scalar<T>{array.values[k], array.variances[k]};
+
+}
+
+template <class T>
+typename ScalarArray<T>::Reference& ScalarArray<T>::Reference::operator=(const Scalar<T>& scalar){
+
+  array.values[k] = scalar.getValue();
+  array.variances[k] = scalar.getVariance();
+  return *this;
+
+}
+
+template <class T>
+typename ScalarArray<T>::Reference& ScalarArray<T>::Reference::operator+=(const Scalar<T>& scalar){
+
+  array.values[k] += scalar.getValue();
+  array.variances[k] += scalar.getVariance();
+  return *this;
+
+}
+
+template <class T>
+typename ScalarArray<T>::Reference& ScalarArray<T>::Reference::operator+=(const Reference& other){
+
+  array.values[k] += other.array.values[other.k];
+  array.variances[k] += other.array.variances[other.k];
+  return *this;
+
+}
+
+template <class T>
+ScalarArray<T>::ScalarArray(unsigned size, const Scalar<T>& scalar):values(size, scalar.getValue()),variances(size, scalar.getVariance()){
+
+}
+
+template <class T>
+template <class Iterator>
+ScalarArray<T>::ScalarArray(Iterator firstScalar, Iterator lastScalar){
+
+  for(auto it = firstScalar; it != lastScalar; ++it){
+
+    values.emplace_back(it->getValue());
+    variances.emplace_back(it->getVariance());
+
+  }
+
+}
+
+template <class T>
+unsigned ScalarArray<T>::size() const{
+
+  return values.size();
+
+}
+
+template <class T>
+typename ScalarArray<T>::Reference ScalarArray<T>::operator[](unsigned k){
+
+  return Reference(*this, k);
+
+}
+
+template <class T>
+Scalar<T> ScalarArray<T>::operator[](unsigned k) const{
+
+  return Scalar<T>{values[k], variances[k]};
+
+}
+
+template <class T>
+typename ScalarArray<T>::Reference ScalarArray<T>::at(unsigned k){
+
+  values.at(k);//throws std::out_of_range
+  return Reference(*this, k);
+
+}
+
+template <class T>
+Scalar<T> ScalarArray<T>::at(unsigned k) const{
+
+  return Scalar<T>{values.at(k), variances.at(k)};
+
+}
+
+template <class T>
+std::vector<T>& ScalarArray<T>::getValues(){
+
+  return values;
+
+}
+
+template <class T>
+const std::vector<T>& ScalarArray<T>::getValues() const{
+
+  return values;
+
+}
+
+template <class T>
+std::vector<T>& ScalarArray<T>::getVariances(){
+
+  return variances;
+
+}
+
+template <class T>
+const std::vector<T>& ScalarArray<T>::getVariances() const{
+
+  return variances;
+
+}
+
+template <class T>
+Scalar<T> ScalarArray<T>::getTotal() const{
+
+  T totalValue{}, totalVariance{};
+  const T* value = values.data();
+  const T* variance = variances.data();
+  #pragma omp simd reduction(+:totalValue,totalVariance)
+  for(unsigned k = 0; k < size(); ++k){
+
+    totalValue += value[k];
+    totalVariance += variance[k];
+
+  }
+
+  return Scalar<T>{totalValue, totalVariance};
+
+}
+
+template <class T>
+std::vector<Scalar<T>> ScalarArray<T>::toScalars() const{
+
+  std::vector<Scalar<T>> scalars;
+  for(unsigned k = 0; k < size(); ++k) scalars.emplace_back(values[k], variances[k]);
+  return scalars;
+
+}
+
+template <class T>
+ScalarArray<T>& ScalarArray<T>::operator*=(const T& factor){
+
+  T* value = values.data();
+  T* variance = variances.data();
+  #pragma omp simd
+  for(unsigned k = 0; k < size(); ++k){
+
+    value[k] *= factor;
+    variance[k] *= factor * factor;
+
+  }
+
+  return *this;
+
+}
+
+template <class T>
+ScalarArray<T>& ScalarArray<T>::operator*=(const Scalar<T>& factor){
+
+  T factorValue = factor.getValue(), factorVariance = factor.getVariance();
+  T* value = values.data();
+  T* variance = variances.data();
+  #pragma omp simd
+  for(unsigned k = 0; k < size(); ++k){
+
+    variance[k] = value[k] * value[k] * factorVariance + factorValue * factorValue * variance[k] + variance[k] * factorVariance;//Scalar::operator*= without covariance
+    value[k] *= factorValue;
+
+  }
+
+  return *this;
+
+}
+
+template <class T>
+ScalarArray<T>& ScalarArray<T>::operator/=(const T& divider){
+
+  if(divider != T{}) return *this *= 1/divider;
+  else{
+
+    Tracer(Verbose::Warning)<<"Scalar array division by "<<divider<<" not allowed!"<<std::endl;
+    return *this;
+
+  }
+
+}
+
+template <class T>
+ScalarArray<T>& ScalarArray<T>::operator/=(const Scalar<T>& divider){
+
+  T dividerValue = divider.getValue(), dividerVariance = divider.getVariance();
+  if(dividerValue == T{}){
+
+    Tracer(Verbose::Warning)<<"Scalar array division by "<<dividerValue<<" not allowed!"<<std::endl;
+    return *this;
+
+  }
+
+  T* value = values.data();
+  T* variance = variances.data();
+  T squaredDivider = dividerValue * dividerValue;
+  #pragma omp simd
+  for(unsigned k = 0; k < size(); ++k){
+
+    variance[k] = (variance[k] + value[k] * value[k] * dividerVariance / squaredDivider) / squaredDivider;//Scalar::operator/= without covariance
+    value[k] = value[k] / dividerValue + value[k] * dividerVariance / (squaredDivider * dividerValue);
+
+  }
+
+  return *this;
+
+}
+
+template <class T>
+ScalarArray<T>& ScalarArray<T>::operator+=(const ScalarArray<T>& other){
+
+  if(other.size() != size()){
+
+    Tracer(Verbose::Error)<<"Adding scalar arrays of sizes "<<size()<<" and "<<other.size()<<" => Array not added"<<std::endl;
+    return *this;
+
+  }
+
+  T* value = values.data();
+  T* variance = variances.data();
+  const T* otherValue = other.values.data();
+  const T* otherVariance = other.variances.data();
+  #pragma omp simd
+  for(unsigned k = 0; k < size(); ++k){
+
+    value[k] += otherValue[k];
+    variance[k] += otherVariance[k];
+
+  }
+
+  return *this;
+
+}
+
+template <class T>
+ScalarArray<T>& ScalarArray<T>::operator-=(const ScalarArray<T>& other){
+
+  if(other.size() != size()){
+
+    Tracer(Verbose::Error)<<"Subtracting scalar arrays of sizes "<<size()<<" and "<<other.size()<<" => Array not subtracted"<<std::endl;
+    return *this;
+
+  }
+
+  T* value = values.data();
+  T* variance = variances.data();
+  const T* otherValue = other.values.data();
+  const T* otherVariance = other.variances.data();
+  #pragma omp simd
+  for(unsigned k = 0; k < size(); ++k){
+
+    value[k] -= otherValue[k];
+    variance[k] += otherVariance[k];
+
+  }
+
+  return *this;
+
+}
+
+template <class T>
+ScalarArray<T>& ScalarArray<T>::operator*=(const ScalarArray<T>& other){
+
+  if(other.size() != size()){
+
+    Tracer(Verbose::Error)<<"Multiplying scalar arrays of sizes "<<size()<<" and "<<other.size()<<" => Array not multiplied"<<std::endl;
+    return *this;
+
+  }
+
+  T* value = values.data();
+  T* variance = variances.data();
+  const T* otherValue = other.values.data();
+  const T* otherVariance = other.variances.data();
+  #pragma omp simd
+  for(unsigned k = 0; k < size(); ++k){
+
+    variance[k] = value[k] * value[k] * otherVariance[k] + otherValue[k] * otherValue[k] * variance[k] + variance[k] * otherVariance[k];
+    value[k] *= otherValue[k];
+
+  }
+
+  return *this;
+
+}
+
+template <class T>
+ScalarArray<T>& ScalarArray<T>::operator/=(const ScalarArray<T>& other){
+
+  if(other.size() != size()){
+
+    Tracer(Verbose::Error)<<"Dividing scalar arrays of sizes "<<size()<<" and "<<other.size()<<" => Array not divided"<<std::endl;
+    return *this;
+
+  }
+
+  T* value = values.data();
+  T* variance = variances.data();
+  const T* otherValue = other.values.data();
+  const T* otherVariance = other.variances.data();
+  unsigned numberOfZeroDividers{};
+  #pragma omp simd reduction(+:numberOfZeroDividers)
+  for(unsigned k = 0; k < size(); ++k){
+
+    bool zeroDivider = otherValue[k] == T{};
+    numberOfZeroDividers += zeroDivider;
+    T dividerValue = zeroDivider ? T{1} : otherValue[k];//leaves the element unchanged
+    T dividerVariance = zeroDivider ? T{} : otherVariance[k];
+    T squaredDivider = dividerValue * dividerValue;
+    variance[k] = (variance[k] + value[k] * value[k] * dividerVariance / squaredDivider) / squaredDivider;
+    value[k] = value[k] / dividerValue + value[k] * dividerVariance / (squaredDivider * dividerValue);
+
+  }
+
+  if(numberOfZeroDividers != 0) Tracer(Verbose::Warning)<<"Scalar array division of "<<numberOfZeroDividers<<" elements by "<<T{}<<" not allowed!"<<std::endl;
+  return *this;
+
+}
+
+#endif
@@ -1,9 +1,12 @@
 #ifndef SIMULATION_H
 #define SIMULATION_H
 
+#include <sstream>
+#include <stdexcept>
 #include "Experiment.hpp"
 #include "Constants.hpp"
 #include "Tracer.hpp"
+#include "Parallel.hpp"
 
 template <class T, class K>
 class Simulation{//class meant to hold runs in the corresponding configuration bin
@@ -11,19 +14,39 @@ class Simulation{//class meant to hold runs in the corresponding configuration b
   double averageDistance;//average distance from the (equivalent) reactor to the detector
   double theta13;//to apply the neutrino oscillation to the neutrino spectrum
   double delta31;//mass to apply the oscillation
-  std::vector<Histogram<T,K>> referenceSpectra;//must follow the order of the bin edges in Experiment
+  std::vector<Bin<T>> referenceChannels;//union of the energy channels of the reference spectra, in increasing order
+  unsigned numberOfIsotopes;
+  std::vector<K> referenceMatrix;//isotopes x energy channels, one reference spectrum per row in the order of the bin edges in Experiment
+  std::vector<Bin<T>> weighedConfigurations;//configurations for which weighedMatrix was computed
+  std::vector<K> weighedMatrix;//configurations x energy channels: reference spectra weighed with the composition of each configuration
+  bool upToDateWeights;//reset when the reference spectra change
   std::map<Bin<T>, Histogram<T,K>> results;//for each configuration/bin in the experiment, compute the simulated spectrum
+  Binning<T> binning;//index of the channels of the last experiment the results were built from
+  std::vector<Histogram<T,K>*> indexedResults;//result of each channel of binning, in the order of its channels
+  void indexResults();
+  std::vector<std::pair<Bin<T>, double>> response;//oscillation times cross section of each energy channel, shared by all results
+  bool upToDateResponse;//reset when the parameters or the energy channels change
+  double getResponse(const Bin<T>& energyChannel) const;
+  template <class Iterator>
+  void buildReferenceMatrix(Iterator beginReferenceSpectra, Iterator endReferenceSpectra);
+  void weighReferenceMatrix();//(configurations x isotopes).(isotopes x energy channels) for the configurations in weighedConfigurations
   
 public:
   template <class Iterator>  
   Simulation(double averageDistance, double theta13, double delta31, Iterator beginReferenceSpectra, Iterator endReferenceSpectra);
   Simulation(double averageDistance, double theta13, double delta31, std::initializer_list<Histogram<T,K>> referenceSpectra);
+  Simulation(const Simulation<T,K>& other);//indexedResults must point to the copied results
+  Simulation(Simulation<T,K>&& other) = default;//the nodes of the results, hence indexedResults, are transferred
+  Simulation<T,K>& operator=(const Simulation<T,K>& other);
+  Simulation<T,K>& operator=(Simulation<T,K>&& other) = default;
   double getAverageDistance() const;
   double getTheta13() const;
   double getDelta31() const;
   unsigned getAdmissbleConfigurationSize() const;
   template<class CoordinateType>
-  const Histogram<T,K>& getResulingSpectrum(const Point<CoordinateType>& configration) const;//get the spectrum from 'results' whose corresponding bin contains the 'configuration'
+  const Histogram<T,K>* findResultingSpectrum(const Point<CoordinateType>& configuration) const;//returns nullptr if no result contains the configuration
+  template<class CoordinateType>
+  const Histogram<T,K>& getResulingSpectrum(const Point<CoordinateType>& configration) const;//get the spectrum from 'results' whose corresponding bin contains the 'configuration', throws std::out_of_range if there is none
   const std::map<Bin<T>, Histogram<T,K>>& getResults() const;
   void setAverageDistance(double averageDistance);
   void setTheta13(double theta13);
@@ -32,9 +55,10 @@ public:
   void setReferenceSpectra(Iterator beginReferenceSpectra, Iterator endReferenceSpectra);
   void setReferenceSpectra(std::initializer_list<Histogram<T,K>> referenceSpectra);
   template<class ConfigurationType, class RunType>
-  void buildFrom(const Experiment<ConfigurationType, RunType>& experiment);//build the reference results according to the configrations of the experiment
+  void buildFrom(const Experiment<ConfigurationType, RunType>& experiment);//build the reference results according to the configrations of the experiment, reusing the weighed spectra while the configurations do not change
   void applyOscillation();
   void applyCrossSection();
+  void applyResponse();//apply the oscillation and the cross section in one pass over all results, computing them once per energy channel
   template<class ConfigurationType, class RunType>
   void scaleCountsTo(const Experiment<ConfigurationType, RunType>& experiment);//normalise each spectrum in results to the rate obtained for the corresponding configration in the experiment
   template<class ConfigurationType, class RunType>
@@ -57,7 +81,9 @@ std::ostream& operator<<(std::ostream& output, const Simulation<T,K>& simulation
 
 template <class T, class K>
 template <class Iterator> 
-Simulation<T,K>::Simulation(double averageDistance, double theta13, double delta31, Iterator beginReferenceSpectra, Iterator endReferenceSpectra):averageDistance(averageDistance),theta13(theta13),delta31(delta31),referenceSpectra(beginReferenceSpectra,endReferenceSpectra){
+Simulation<T,K>::Simulation(double averageDistance, double theta13, double delta31, Iterator beginReferenceSpectra, Iterator endReferenceSpectra):averageDistance(averageDistance),theta13(theta13),delta31(delta31),upToDateWeights(false),upToDateResponse(false){
+
+  buildReferenceMatrix(beginReferenceSpectra, endReferenceSpectra);
 
 }
 
@@ -66,6 +92,28 @@ Simulation<T,K>::Simulation(double averageDistance, double theta13, double delta
 
 }
 
+template <class T, class K>
+Simulation<T,K>::Simulation(const Simulation<T,K>& other):averageDistance(other.averageDistance),theta13(other.theta13),delta31(other.delta31),referenceChannels(other.referenceChannels),numberOfIsotopes(other.numberOfIsotopes),referenceMatrix(other.referenceMatrix),weighedConfigurations(other.weighedConfigurations),weighedMatrix(other.weighedMatrix),upToDateWeights(other.upToDateWeights),results(other.results),binning(other.binning),response(other.response),upToDateResponse(other.upToDateResponse){
+
+  indexResults();
+
+}
+
+template <class T, class K>
+Simulation<T,K>& Simulation<T,K>::operator=(const Simulation<T,K>& other){
+
+  return *this = Simulation<T,K>(other);
+
+}
+
+template <class T, class K>
+void Simulation<T,K>::indexResults(){
+
+  indexedResults.clear();
+  for(const auto& channel : binning.getChannels()) indexedResults.emplace_back(&results.at(channel));
+
+}
+
 template <class T, class K>
 double Simulation<T,K>::getAverageDistance() const{
   
@@ -90,23 +138,38 @@ double Simulation<T,K>::getDelta31() const{
 template <class T, class K>
 unsigned Simulation<T,K>::getAdmissbleConfigurationSize() const{
 
-  return referenceSpectra.size();
+  return numberOfIsotopes;
   
 }
 
 template <class T, class K>
 template<class CoordinateType>
-const Histogram<T,K>& Simulation<T,K>::getResulingSpectrum(const Point<CoordinateType>& configuration) const{
+const Histogram<T,K>* Simulation<T,K>::findResultingSpectrum(const Point<CoordinateType>& configuration) const{
   
-  auto it = std::find_if(results.begin(), results.end(),[&](const auto& pairHist){return pairHist.first.contains(configuration);});
-  if(it != results.end()) return it->second;
-  else{
+  if(configuration.getDimension() >= binning.getDimension()){//locate the cell of the configuration in the index
     
-    Tracer(Verbose::Error)<<"No simulated spectrum matches: "<<configuration<<" => Returning first result\n";
-    return results.begin()->second;
+    unsigned channelIndex = binning.findChannel(configuration.begin(), configuration.end());
+    if(channelIndex != binning.getNumberOfChannels()) return indexedResults[channelIndex];
     
   }
   
+  auto it = std::find_if(results.begin(), results.end(),[&](const auto& pairHist){return pairHist.first.contains(configuration);});//results of previous experiments or partial configurations
+  if(it != results.end()) return &it->second;
+  else return nullptr;
+  
+}
+
+template <class T, class K>
+template<class CoordinateType>
+const Histogram<T,K>& Simulation<T,K>::getResulingSpectrum(const Point<CoordinateType>& configuration) const{
+  
+  auto spectrum = findResultingSpectrum(configuration);
+  if(spectrum) return *spectrum;
+  
+  std::ostringstream message;
+  message<<"No simulated spectrum matches: "<<configuration;
+  throw std::out_of_range(message.str());
+  
 }
 
 template <class T, class K>
@@ -120,6 +183,7 @@ template <class T, class K>
 void Simulation<T,K>::setAverageDistance(double averageDistance){
   
   this->averageDistance = averageDistance;
+  upToDateResponse = false;
 
 }
 
@@ -127,6 +191,7 @@ template <class T, class K>
 void Simulation<T,K>::setTheta13(double theta13){
 
   this->theta13 = theta13;
+  upToDateResponse = false;
   
 }
 
@@ -134,6 +199,7 @@ template <class T, class K>
 void Simulation<T,K>::setDelta13(double delta31){
   
   this->delta31 = delta31;
+  upToDateResponse = false;
 
 }
 
@@ -141,7 +207,9 @@ template <class T, class K>
 template <class Iterator>
 void Simulation<T,K>::setReferenceSpectra(Iterator beginReferenceSpectra, Iterator endReferenceSpectra){
   
-  referenceSpectra.assign(beginReferenceSpectra, endReferenceSpectra);
+  buildReferenceMatrix(beginReferenceSpectra, endReferenceSpectra);
+  upToDateWeights = false;
+  upToDateResponse = false;
   
 }
 
@@ -156,9 +224,79 @@ template <class T, class K>
 template<class ConfigurationType, class RunType>
 void Simulation<T,K>::buildFrom(const Experiment<ConfigurationType, RunType>& experiment){
   
-  for(const auto& pairBin : experiment)
-    results[pairBin.first] = weigh(pairBin.first.getCenter(), referenceSpectra.begin(), referenceSpectra.end());//weigh reference spectra with the composition
+  std::vector<Bin<T>> configurations;
+  for(const auto& pairBin : experiment) configurations.emplace_back(pairBin.first);
+  
+  auto equivalent = [](const Bin<T>& bin1, const Bin<T>& bin2){return !(bin1 < bin2) && !(bin2 < bin1);};
+  if(!upToDateWeights || configurations.size() != weighedConfigurations.size() || !std::equal(configurations.begin(), configurations.end(), weighedConfigurations.begin(), equivalent)){
+    
+    weighedConfigurations = std::move(configurations);
+    weighReferenceMatrix();
+    
+  }
+  
+  for(unsigned c = 0; c < weighedConfigurations.size(); ++c){
+    
+    Histogram<T,K> spectrum;
+    for(unsigned j = 0; j < referenceChannels.size(); ++j) spectrum.setCount(referenceChannels[j], weighedMatrix[c * referenceChannels.size() + j]);
+    results[weighedConfigurations[c]] = std::move(spectrum);
+    
+  }
+  
+  binning = experiment.getBinning();
+  indexResults();
+
+}
+
+template <class T, class K>
+template <class Iterator>
+void Simulation<T,K>::buildReferenceMatrix(Iterator beginReferenceSpectra, Iterator endReferenceSpectra){
+  
+  referenceChannels.clear();
+  for(auto it = beginReferenceSpectra; it != endReferenceSpectra; ++it)
+    for(const auto& pairBin : *it) referenceChannels.emplace_back(pairBin.first);
+  
+  std::sort(referenceChannels.begin(), referenceChannels.end());
+  referenceChannels.erase(std::unique(referenceChannels.begin(), referenceChannels.end(), [](const Bin<T>& bin1, const Bin<T>& bin2){return !(bin1 < bin2) && !(bin2 < bin1);}), referenceChannels.end());
+  
+  numberOfIsotopes = std::distance(beginReferenceSpectra, endReferenceSpectra);
+  referenceMatrix.assign(numberOfIsotopes * referenceChannels.size(), K{});//channels missing from a reference spectrum are empty
+  unsigned i{};
+  for(auto it = beginReferenceSpectra; it != endReferenceSpectra; ++it, ++i){
+    
+    auto itChannel = referenceChannels.begin();
+    for(const auto& pairBin : *it){//both are ordered by channel
+      
+      while(*itChannel < pairBin.first) ++itChannel;
+      referenceMatrix[i * referenceChannels.size() + (itChannel - referenceChannels.begin())] = pairBin.second;
+      
+    }
+    
+  }
+  
+}
 
+template <class T, class K>
+void Simulation<T,K>::weighReferenceMatrix(){
+  
+  unsigned numberOfChannels = referenceChannels.size();
+  weighedMatrix.assign(weighedConfigurations.size() * numberOfChannels, K{});
+  
+  parallel::forEachIndex(weighedConfigurations.size(), [&](unsigned c){
+    
+    auto composition = weighedConfigurations[c].getCenter();
+    K* weighedRow = weighedMatrix.data() + c * numberOfChannels;
+    for(unsigned i = 0; i < std::min(numberOfIsotopes, composition.getDimension()); ++i){//as in weigh, extra isotopes or coordinates are ignored
+      
+      const K* referenceRow = referenceMatrix.data() + i * numberOfChannels;
+      for(unsigned j = 0; j < numberOfChannels; ++j) weighedRow[j] += composition.getCoordinate(i) * referenceRow[j];
+      
+    }
+    
+  });
+  
+  upToDateWeights = true;
+  
 }
 
 template <class T, class K>
@@ -179,6 +317,58 @@ void Simulation<T,K>::applyCrossSection(){
   
 }
 
+template <class T, class K>
+double Simulation<T,K>::getResponse(const Bin<T>& energyChannel) const{
+  
+  T energy = energyChannel.getEdge(0).getCenter();
+  return constants::oscillation(energy, averageDistance, theta13, delta31) * constants::crossSection(energy);
+  
+}
+
+template <class T, class K>
+void Simulation<T,K>::applyResponse(){
+  
+  if(results.empty()) return;
+  
+  if(!upToDateResponse){//the results share the energy channels of the reference spectra
+    
+    std::vector<double> energies, survivalProbabilities, crossSections;
+    for(const auto& pairBin : results.begin()->second) energies.emplace_back(pairBin.first.getEdge(0).getCenter());
+    survivalProbabilities.resize(energies.size());
+    crossSections.resize(energies.size());
+    constants::oscillation(energies.data(), survivalProbabilities.data(), energies.size(), averageDistance, theta13, delta31);
+    constants::crossSection(energies.data(), crossSections.data(), energies.size());
+    
+    response.clear();
+    unsigned i{};
+    for(const auto& pairBin : results.begin()->second){
+      
+      response.emplace_back(pairBin.first, survivalProbabilities[i] * crossSections[i]);
+      ++i;
+      
+    }
+    upToDateResponse = true;
+    
+  }
+  
+  std::vector<Histogram<T,K>*> histograms;//random access to the results for the threads
+  for(auto& pairHist : results) histograms.emplace_back(&pairHist.second);
+  
+  parallel::forEachIndex(histograms.size(), [&](unsigned k){
+    
+    auto itResponse = response.begin();
+    for(auto& pairBin : *histograms[k]){//both are ordered by channel, so walk them together
+      
+      while(itResponse != response.end() && itResponse->first < pairBin.first) ++itResponse;
+      if(itResponse != response.end() && !(pairBin.first < itResponse->first)) pairBin.second *= itResponse->second;
+      else pairBin.second *= getResponse(pairBin.first);//channel missing from the cached response
+      
+    }
+    
+  });
+  
+}
+
 template <class T, class K>
 template<class ConfigurationType, class RunType>
 void Simulation<T,K>::scaleCountsTo(const Experiment<ConfigurationType, RunType>& experiment){
@@ -193,8 +383,7 @@ template<class ConfigurationType, class RunType>
 void Simulation<T,K>::simulateToMatch(const Experiment<ConfigurationType, RunType>& experiment){
   
   buildFrom(experiment);
-  applyOscillation();
-  applyCrossSection();
+  applyResponse();
   scaleCountsTo(experiment);
   
 }
@@ -204,6 +393,8 @@ void Simulation<T,K>::shiftResultingSpectra(const T& shift){
   
   for(auto& pairHist : results)
     pairHist.second.shiftChannels(Point<T>(shift));
+  
+  upToDateResponse = false;//the energy channels have moved
 
 }
 
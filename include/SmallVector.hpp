@@ -0,0 +1,239 @@
+#ifndef SMALL_VECTOR_H
+#define SMALL_VECTOR_H
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <initializer_list>
+
+template <class T, unsigned N>
+class SmallVector{//vector keeping up to N elements inline, so that low-dimensional points and bins never allocate
+
+  std::array<T,N> inlineElements{};
+  std::vector<T> heapElements;//only used once the size has exceeded N
+  unsigned numberOfElements{};
+  bool onHeap{};
+  void moveToHeap();
+
+public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = const T*;
+  SmallVector() = default;
+  template <class Iterator>
+  SmallVector(Iterator firstElement, Iterator lastElement);
+  SmallVector(std::initializer_list<T> elements);
+  SmallVector(const SmallVector<T,N>& other) = default;
+  SmallVector(SmallVector<T,N>&& other);//leaves other empty and inline
+  SmallVector<T,N>& operator=(const SmallVector<T,N>& other) = default;
+  SmallVector<T,N>& operator=(SmallVector<T,N>&& other);
+  iterator begin();
+  iterator end();
+  const_iterator begin() const;
+  const_iterator end() const;
+  T* data();
+  const T* data() const;
+  unsigned size() const;
+  bool empty() const;
+  T& operator[](unsigned k);
+  const T& operator[](unsigned k) const;
+  T& at(unsigned k);
+  const T& at(unsigned k) const;
+  template <class... Args>
+  void emplace_back(Args&&... args);
+  template <class... Args>
+  iterator emplace(const_iterator position, Args&&... args);
+  iterator erase(const_iterator position);
+  void resize(unsigned size);
+
+};
+
+template <class T, unsigned N>
+void SmallVector<T,N>::moveToHeap(){
+
+  heapElements.reserve(2 * N + 1);
+  heapElements.assign(std::make_move_iterator(inlineElements.begin()), std::make_move_iterator(inlineElements.begin() + numberOfElements));
+  onHeap = true;
+
+}
+
+template <class T, unsigned N>
+template <class Iterator>
+SmallVector<T,N>::SmallVector(Iterator firstElement, Iterator lastElement){
+
+  for(auto it = firstElement; it != lastElement; ++it) emplace_back(*it);
+
+}
+
+template <class T, unsigned N>
+SmallVector<T,N>::SmallVector(std::initializer_list<T> elements):SmallVector(elements.begin(), elements.end()){
+
+}
+
+template <class T, unsigned N>
+SmallVector<T,N>::SmallVector(SmallVector<T,N>&& other):heapElements(std::move(other.heapElements)),numberOfElements(other.numberOfElements),onHeap(other.onHeap){
+
+  if(!onHeap) std::move(other.inlineElements.begin(), other.inlineElements.begin() + numberOfElements, inlineElements.begin());
+
+  other.heapElements.clear();
+  other.numberOfElements = 0;
+  other.onHeap = false;
+
+}
+
+template <class T, unsigned N>
+SmallVector<T,N>& SmallVector<T,N>::operator=(SmallVector<T,N>&& other){
+
+  if(this == &other) return *this;
+
+  heapElements = std::move(other.heapElements);
+  numberOfElements = other.numberOfElements;
+  onHeap = other.onHeap;
+  if(!onHeap) std::move(other.inlineElements.begin(), other.inlineElements.begin() + numberOfElements, inlineElements.begin());
+
+  other.heapElements.clear();
+  other.numberOfElements = 0;
+  other.onHeap = false;
+
+  return *this;
+
+}
+
+template <class T, unsigned N>
+typename SmallVector<T,N>::iterator SmallVector<T,N>::begin(){
+
+  return data();
+
+}
+
+template <class T, unsigned N>
+typename SmallVector<T,N>::iterator SmallVector<T,N>::end(){
+
+  return data() + numberOfElements;
+
+}
+
+template <class T, unsigned N>
+typename SmallVector<T,N>::const_iterator SmallVector<T,N>::begin() const{
+
+  return data();
+
+}
+
+template <class T, unsigned N>
+typename SmallVector<T,N>::const_iterator SmallVector<T,N>::end() const{
+
+  return data() + numberOfElements;
+
+}
+
+template <class T, unsigned N>
+T* SmallVector<T,N>::data(){
+
+  return onHeap ? heapElements.data() : inlineElements.data();
+
+}
+
+template <class T, unsigned N>
+const T* SmallVector<T,N>::data() const{
+
+  return onHeap ? heapElements.data() : inlineElements.data();
+
+}
+
+template <class T, unsigned N>
+unsigned SmallVector<T,N>::size() const{
+
+  return numberOfElements;
+
+}
+
+template <class T, unsigned N>
+bool SmallVector<T,N>::empty() const{
+
+  return numberOfElements == 0;
+
+}
+
+template <class T, unsigned N>
+T& SmallVector<T,N>::operator[](unsigned k){
+
+  return data()[k];
+
+}
+
+template <class T, unsigned N>
+const T& SmallVector<T,N>::operator[](unsigned k) const{
+
+  return data()[k];
+
+}
+
+template <class T, unsigned N>
+T& SmallVector<T,N>::at(unsigned k){
+
+  if(k < numberOfElements) return data()[k];
+  else throw std::out_of_range("SmallVector has no element "+std::to_string(k));
+
+}
+
+template <class T, unsigned N>
+const T& SmallVector<T,N>::at(unsigned k) const{
+
+  if(k < numberOfElements) return data()[k];
+  else throw std::out_of_range("SmallVector has no element "+std::to_string(k));
+
+}
+
+template <class T, unsigned N>
+template <class... Args>
+void SmallVector<T,N>::emplace_back(Args&&... args){
+
+  if(!onHeap && numberOfElements == N) moveToHeap();
+
+  if(onHeap) heapElements.emplace_back(std::forward<Args>(args)...);
+  else inlineElements[numberOfElements] = T(std::forward<Args>(args)...);
+
+  ++numberOfElements;
+
+}
+
+template <class T, unsigned N>
+template <class... Args>
+typename SmallVector<T,N>::iterator SmallVector<T,N>::emplace(const_iterator position, Args&&... args){
+
+  unsigned k = position - begin();
+  emplace_back(std::forward<Args>(args)...);
+  std::rotate(begin() + k, end() - 1, end());//bring the new element to its position
+  return begin() + k;
+
+}
+
+template <class T, unsigned N>
+typename SmallVector<T,N>::iterator SmallVector<T,N>::erase(const_iterator position){
+
+  unsigned k = position - begin();
+  std::move(begin() + k + 1, end(), begin() + k);
+
+  if(onHeap) heapElements.pop_back();
+  --numberOfElements;
+
+  return begin() + k;
+
+}
+
+template <class T, unsigned N>
+void SmallVector<T,N>::resize(unsigned size){
+
+  if(!onHeap && size > N) moveToHeap();
+
+  if(onHeap) heapElements.resize(size);
+  else for(unsigned k = numberOfElements; k < size; ++k) inlineElements[k] = T{};
+
+  numberOfElements = size;
+
+}
+
+#endif
@@ -1,19 +1,24 @@
 #include "boost/filesystem.hpp"
 #include "boost/program_options.hpp"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
 #include "TFile.h"
+#include "TROOT.h"
 #include "ExperimentExtractor.hpp"
 #include "Converter.hpp"
 #include "Binner.hpp"
 #include "Simulation.hpp"
+#include "ParameterScan.hpp"
+#include "Parallel.hpp"
 
 namespace bpo = boost::program_options;
 
-void neutrinoRetriever(TTree* data, TTree* simu1, TTree* simu2, const char* outname, const std::vector<Histogram<double, double>>& referenceSpectra){
+void neutrinoRetriever(const RunTable& runTable, const char* outname, const std::vector<Histogram<double, double>>& referenceSpectra){
   
   Binner<double> binner({Axis<double>(5, 0.44, 0.66), Axis<double>(2, 0.085, 0.091), Axis<double>(5, 0.22, 0.4), Axis<double>(2, 0.03, 0.08)});
   
-  ExperimentExtractor experimentExtractor(data, simu1, simu2);//use the simulations to create Fuel bins for the data
-  auto experiment = experimentExtractor.extractExperiment<double, double>(constants::distance::L1, constants::distance::L2, constants::backgroundRate::total, binner.generateBinning());
+  auto experiment = runTable.getExperiment<double, double>(constants::distance::L1, constants::distance::L2, constants::backgroundRate::total, binner.generateBinning());
   experiment.slim();
   std::cout<<experiment<<"\n";
   
@@ -22,6 +27,9 @@ void neutrinoRetriever(TTree* data, TTree* simu1, TTree* simu2, const char* outn
   simulation.shiftResultingSpectra(constants::mass::proton - constants::mass::neutron  + constants::mass::electron);//convert the neutrino's energy to the positron's energy + electron's annihilation mass
 //   std::cout<<"Simulation:\n"<<simulation;
   
+  ParameterScan<double, double> parameterScan(experiment, simulation, constants::mass::proton - constants::mass::neutron  + constants::mass::electron);//must be built before integrating the configurations
+  auto chiSquareSurface = parameterScan.scan(Axis<double>(40, 0., 0.2), Axis<double>(40, 1.5e-3, 3.5e-3));
+  
    std::cout<<"Integrated Experiment:\n"<<experiment.integrateChannels({1,3})<<"\n";
   
   TFile outfile(outname, "recreate");
@@ -40,6 +48,9 @@ void neutrinoRetriever(TTree* data, TTree* simu1, TTree* simu2, const char* outn
     rate->Write("rate");
     
   }
+  
+  auto chiSquare = Converter::toTH1(chiSquareSurface);
+  if(chiSquare) chiSquare->Write("chiSquare");//theta13 along x, delta31 along y
 
 //   Point<double> referenceConfiguration{0.575, 0.0875, 0.274, 0.0425};//U5,U8,PU9,PU41
 //   auto normaliserSimu = simulation.getResulingSpectrum(referenceConfiguration);
@@ -66,10 +77,10 @@ void neutrinoRetriever(TTree* data, TTree* simu1, TTree* simu2, const char* outn
   Point<double> referenceConfiguration{0.5, 0.35};
   auto normaliser = experiment.getScaledNeutrinoSpectrum<double, double>(referenceConfiguration, energyChannels);
   unsigned index{};
-  for(const auto& pair : experiment){
+  for(const auto& pair : experiment.getScaledNeutrinoSpectra<double,Scalar<double>>(energyChannels)){//the spectra of all configurations are computed in parallel
    
-    energyHistogram = pair.second.getScaledNeutrinoSpectrum<double,Scalar<double>>(experiment.getDistance1(), experiment.getDistance2(), experiment.getBackgroundRate(),energyChannels);
-//     energyHistogram = pair.second.getNeutrinoSpectrum<double,Scalar<double>>(energyChannels);
+    energyHistogram = pair.second;
+//     energyHistogram = experiment.getNeutrinoSpectrum<double,Scalar<double>>(pair.first.getCenter(), energyChannels);
 //     energyHistogram /= normaliser;
     
     auto spectrum = Converter::toTH1(energyHistogram);
@@ -86,13 +97,88 @@ void neutrinoRetriever(TTree* data, TTree* simu1, TTree* simu2, const char* outn
   
 }
 
-void monitor(const boost::filesystem::path& dataPath, const boost::filesystem::path& referenceSpectraPath, const std::vector<boost::filesystem::path>& simulationPaths, const boost::filesystem::path& outputPath, Verbose verbose){
+std::vector<boost::filesystem::path> expandPaths(const std::vector<boost::filesystem::path>& paths){//replace the directories by the ROOT files they contain and the manifests (.list) by the paths they list
   
-  Tracer::setGlobalVerbosity(verbose);//set the static variable
+  std::vector<boost::filesystem::path> files;
+  for(const auto& path : paths){
+    
+    if(boost::filesystem::is_directory(path)){
+      
+      std::vector<boost::filesystem::path> directoryFiles;
+      for(const auto& entry : boost::filesystem::directory_iterator(path)) if(entry.path().extension() == ".root") directoryFiles.emplace_back(entry.path());
+      std::sort(directoryFiles.begin(), directoryFiles.end());//process the periods in order
+      files.insert(files.end(), directoryFiles.begin(), directoryFiles.end());
+      
+    }
+    else if(path.extension() == ".list"){
+      
+      std::ifstream manifest(path.string());
+      std::string line;
+      while(std::getline(manifest, line)){
+        
+        if(line.empty() || line.front() == '#') continue;
+        boost::filesystem::path file(line);
+        files.emplace_back(file.is_relative() ? path.parent_path() / file : file);//relative paths start from the manifest
+        
+      }
+      
+    }
+    else files.emplace_back(path);
+    
+  }
+  
+  return files;
+  
+}
+
+std::string describeSources(const std::vector<boost::filesystem::path>& dataPaths, const std::vector<std::pair<boost::filesystem::path, boost::filesystem::path>>& simulationPaths){//identifies the inputs of a run table by their paths, sizes and modification times
+  
+  std::ostringstream description;
+  auto describe = [&](const char* role, const boost::filesystem::path& file){
+    
+    boost::system::error_code error;//a missing file is described by invalid values, the extraction reports it
+    description<<role<<' '<<file.string()<<' '<<boost::filesystem::file_size(file, error)<<' '<<boost::filesystem::last_write_time(file, error)<<'\n';
+    
+  };
+  
+  for(const auto& file : dataPaths) describe("data", file);
+  for(const auto& files : simulationPaths){
+    
+    describe("reactor1", files.first);
+    describe("reactor2", files.second);
+    
+  }
   
-  TFile dataFile(dataPath.c_str());
-  TFile simuFile1(simulationPaths.front().c_str());
-  TFile simuFile2(simulationPaths.back().c_str());
+  return description.str();
+  
+}
+
+RunTable getRunTable(const std::vector<boost::filesystem::path>& dataPaths, const std::vector<std::pair<boost::filesystem::path, boost::filesystem::path>>& simulationPaths, const boost::filesystem::path& cachePath, unsigned queueDepth){
+  
+  RunTable runTable;
+  std::string sources = describeSources(dataPaths, simulationPaths);
+  
+  if(!cachePath.empty() && boost::filesystem::is_regular_file(cachePath) && runTable.load(cachePath.string(), sources)) return runTable;//the cache must have been extracted from the same, unchanged trees
+  
+  ExperimentExtractor experimentExtractor;//use the simulations to create Fuel bins for the data
+  std::vector<std::string> dataFiles;
+  for(const auto& file : dataPaths) dataFiles.emplace_back(file.string());
+  bool allRead = experimentExtractor.addDataFiles(dataFiles, queueDepth);//one file is open at a time, read ahead of the grouping of its entries by run
+  for(const auto& files : simulationPaths) allRead = experimentExtractor.addSimulationFiles(files.first.string(), files.second.string()) && allRead;
+  
+  runTable = experimentExtractor.extractRunTable();
+  if(!allRead) Tracer(Verbose::Error)<<"Some trees cannot be read => Incomplete run table not cached"<<std::endl;
+  else if(!cachePath.empty()) runTable.save(cachePath.string(), sources);
+  
+  return runTable;
+  
+}
+
+void monitor(const std::vector<boost::filesystem::path>& dataPaths, const boost::filesystem::path& referenceSpectraPath, const std::vector<std::pair<boost::filesystem::path, boost::filesystem::path>>& simulationPaths, const boost::filesystem::path& outputPath, const boost::filesystem::path& cachePath, Verbose verbose, unsigned numberOfThreads, unsigned queueDepth){
+  
+  Tracer::setGlobalVerbosity(verbose);//set the static variable
+  parallel::setNumberOfThreads(numberOfThreads);
+  ROOT::EnableThreadSafety();//the trees are read in a separate thread
   
   TFile referenceSpectraFile(referenceSpectraPath.c_str());
   std::vector<Histogram<double, double>> referenceSpectra(4);
@@ -101,28 +187,29 @@ void monitor(const boost::filesystem::path& dataPath, const boost::filesystem::p
   referenceSpectra[2] = Converter::toHistogram<double,double>(*dynamic_cast<TH1D*>(referenceSpectraFile.Get("Pu239")));
   referenceSpectra[3] = Converter::toHistogram<double,double>(*dynamic_cast<TH1D*>(referenceSpectraFile.Get("Pu241")));
   
-  TTree* data = dynamic_cast<TTree*>(dataFile.Get("FinalFitIBDTree"));
-  TTree* simu1 = dynamic_cast<TTree*>(simuFile1.Get("nu"));
-  TTree* simu2 = dynamic_cast<TTree*>(simuFile2.Get("nu"));
-  
-  neutrinoRetriever(data, simu1, simu2, outputPath.c_str(), referenceSpectra);
+  neutrinoRetriever(getRunTable(dataPaths, simulationPaths, cachePath, queueDepth), outputPath.c_str(), referenceSpectra);
   
 }
 
 int main(int argc, char* argv[]){
   
-  boost::filesystem::path dataPath, referenceSpectraPath, outputPath;
-  std::vector<boost::filesystem::path> simulationPaths;
+  boost::filesystem::path referenceSpectraPath, outputPath, cachePath;
+  std::vector<boost::filesystem::path> dataPaths, simulationPaths1, simulationPaths2;
   Verbose verbose;
+  unsigned numberOfThreads, queueDepth;
   
   bpo::options_description optionDescription("Monitor usage");
   optionDescription.add_options()
   ("help,h", "Display this help message")
-  ("data,d", bpo::value<boost::filesystem::path>(&dataPath)->required(), "Data tree")
+  ("data,d", bpo::value<std::vector<boost::filesystem::path>>(&dataPaths)->required()->multitoken(), "Data trees (files, directories or .list manifests)")
   ("reference,r", bpo::value<boost::filesystem::path>(&referenceSpectraPath)->required(), "Reference spectra file")
-  ("simulations,s", bpo::value<std::vector<boost::filesystem::path>>(&simulationPaths)->required()->multitoken(), "Simulation trees")
+  ("reactor1", bpo::value<std::vector<boost::filesystem::path>>(&simulationPaths1)->required()->multitoken(), "Simulation trees of reactor 1, one per period (files, directories or .list manifests)")
+  ("reactor2", bpo::value<std::vector<boost::filesystem::path>>(&simulationPaths2)->required()->multitoken(), "Simulation trees of reactor 2, in the same order of the periods as for reactor 1")
   ("output,o", bpo::value<boost::filesystem::path>(&outputPath)->required(), "Output file where to save the rate and shape evolution")
-  ("verbose,v", bpo::value<Verbose>(&verbose)->default_value(Verbose::Error),"Verbose level (Quiet, Error, Warning, Debug)");;
+  ("cache,c", bpo::value<boost::filesystem::path>(&cachePath), "Run table cache, written after reading the trees and read instead of them while the trees are unchanged")
+  ("verbose,v", bpo::value<Verbose>(&verbose)->default_value(Verbose::Error),"Verbose level (Quiet, Error, Warning, Debug)")
+  ("threads,t", bpo::value<unsigned>(&numberOfThreads)->default_value(0), "Number of threads used to compute the rates and spectra (0 for all hardware threads)")
+  ("queue,q", bpo::value<unsigned>(&queueDepth)->default_value(4), "Number of data chunks read ahead of their processing");
 
   bpo::positional_options_description positionalOptions;//to use arguments without "--"
   positionalOptions.add("data", -1);
@@ -149,19 +236,33 @@ int main(int argc, char* argv[]){
     
   }
   
-  if(!boost::filesystem::is_regular_file(dataPath)) std::cout<<"Error: '"<<dataPath<<"' is not a regular file"<<std::endl;
+  dataPaths = expandPaths(dataPaths);
+  simulationPaths1 = expandPaths(simulationPaths1);
+  simulationPaths2 = expandPaths(simulationPaths2);
+  
+  if(dataPaths.empty()) std::cout<<"Error: no data file"<<std::endl;
   else if(!boost::filesystem::is_regular_file(referenceSpectraPath)) std::cout<<"Error: '"<<referenceSpectraPath<<"' is not a regular file"<<std::endl;
-  else if(simulationPaths.size() != 2) std::cout<<"Error : wrong number of simulation files (2 needed)"<<std::endl;
+  else if(simulationPaths1.empty() || simulationPaths1.size() != simulationPaths2.size()) std::cout<<"Error: "<<simulationPaths1.size()<<" reactor 1 and "<<simulationPaths2.size()<<" reactor 2 simulation files (one of each needed for every period)"<<std::endl;
   else{
     
-    for (const auto& file : simulationPaths) if(!boost::filesystem::is_regular_file(file)){
+    for(const auto& file : dataPaths) if(!boost::filesystem::is_regular_file(file)){
+      
+      std::cout<<"Error: '"<<file<<"' is not a regular file"<<std::endl;
+      return 1;
+      
+    }
+    
+    std::vector<std::pair<boost::filesystem::path, boost::filesystem::path>> simulationPaths;//reactor 1 and reactor 2 files of each period
+    for(unsigned k = 0; k < simulationPaths1.size(); ++k) simulationPaths.emplace_back(simulationPaths1[k], simulationPaths2[k]);
+    
+    for (const auto& files : simulationPaths) for(const auto& file : {files.first, files.second}) if(!boost::filesystem::is_regular_file(file)){
       
       std::cout<<"Error: '"<<file<<"' is not a regular file"<<std::endl;
       return 1;
       
     }
      
-    monitor(dataPath, referenceSpectraPath, simulationPaths, outputPath, verbose);
+    monitor(dataPaths, referenceSpectraPath, simulationPaths, outputPath, cachePath, verbose, numberOfThreads, queueDepth);
     
   }
   
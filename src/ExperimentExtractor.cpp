@@ -1,24 +1,282 @@
 #include "ExperimentExtractor.hpp"
+#include <algorithm>
+#include <unordered_set>
+#include <thread>
+#include <exception>
+#include "TFile.h"
+#include "Tracer.hpp"
+#include "BoundedQueue.hpp"
 
-ExperimentExtractor::ExperimentExtractor(TTree* data, TTree* simu1, TTree* simu2):data(data),simu1(simu1),simu2(simu2){
+namespace{
   
-  data->SetBranchAddress("RunNumber", &runData);
-  data->SetBranchAddress("myPromptEvisID", &(currentEnergy));
+  const Long64_t cacheSize = 64 * 1024 * 1024;//size of the TTreeCache in bytes
+  
+  void selectBranches(TTree* tree, const std::vector<const char*>& branchNames){//only deserialise the needed branches, read by clusters through the cache
+    
+    tree->SetBranchStatus("*", false);
+    for(auto branchName : branchNames) tree->SetBranchStatus(branchName, true);
+    
+    tree->SetCacheSize(cacheSize);
+    for(auto branchName : branchNames) tree->AddBranchToCache(branchName, true);
+    tree->StopCacheLearningPhase();
+    
+  }
+  
+  const Long64_t chunkSize = 1 << 16;//number of data entries read at once
+  
+  template <class Chunk, class Function>
+  void readDataChunks(TTree* data, Function consume){//call consume(chunk) for each chunk of entries, until it returns false
+    
+    selectBranches(data, {"RunNumber", "myPromptEvisID"});
+    
+    int run;
+    double energy;
+    data->SetBranchAddress("RunNumber", &run);
+    data->SetBranchAddress("myPromptEvisID", &energy);
+    
+    TBranch* runBranch = data->GetBranch("RunNumber");
+    TBranch* energyBranch = data->GetBranch("myPromptEvisID");
+    
+    Long64_t numberOfEntries = data->GetEntries();
+    for(Long64_t firstEntry = 0; firstEntry < numberOfEntries; firstEntry += chunkSize){
+      
+      Chunk chunk;
+      Long64_t lastEntry = std::min(firstEntry + chunkSize, numberOfEntries);
+      chunk.runs.reserve(lastEntry - firstEntry);
+      chunk.energies.reserve(lastEntry - firstEntry);
+      
+      for(Long64_t i = firstEntry; i < lastEntry; ++i){//read the two branches only, instead of the whole entry
+        
+        data->LoadTree(i);//sets the read entry of the tree, from which the cache prefetches the cluster
+        runBranch->GetEntry(i);
+        energyBranch->GetEntry(i);
+        chunk.runs.emplace_back(run);
+        chunk.energies.emplace_back(energy);
+        
+      }
+      
+      if(!consume(std::move(chunk))) break;
+      
+    }
+    
+    data->ResetBranchAddresses();//the tree must not keep pointers to the local variables
+    
+  }
+  
+}
+
+ExperimentExtractor::ExperimentExtractor(TTree* data, TTree* simu1, TTree* simu2){
+  
+  addDataTree(data);
+  addSimulationTrees(simu1, simu2);
+
+}
+
+void ExperimentExtractor::appendDataChunk(const DataChunk& chunk){
+  
+  if(!std::is_sorted(chunk.runs.begin(), chunk.runs.end())){//group the entries of interleaved runs first, so that each run is merged once per chunk
+    
+    std::vector<unsigned> order(chunk.runs.size());
+    for(unsigned i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](unsigned i, unsigned j){return chunk.runs[i] < chunk.runs[j];});
+    
+    DataChunk groupedChunk;
+    for(auto i : order){
+      
+      groupedChunk.runs.emplace_back(chunk.runs[i]);
+      groupedChunk.energies.emplace_back(chunk.energies[i]);
+      
+    }
+    
+    appendDataChunk(groupedChunk);
+    return;
+    
+  }
+  
+  for(unsigned firstEntry = 0, lastEntry = 0; firstEntry < chunk.runs.size(); firstEntry = lastEntry){
+    
+    lastEntry = std::upper_bound(chunk.runs.begin() + firstEntry, chunk.runs.end(), chunk.runs[firstEntry]) - chunk.runs.begin();
+    auto& energies = energiesData[chunk.runs[firstEntry]];
+    auto itNew = energies.insert(energies.end(), chunk.energies.begin() + firstEntry, chunk.energies.begin() + lastEntry);
+    std::sort(itNew, energies.end());
+    std::inplace_merge(energies.begin(), itNew, energies.end());//the energies of the run stay sorted
+    
+  }
+  
+}
+
+void ExperimentExtractor::addDataTree(TTree* data){
+  
+  readDataChunks<DataChunk>(data, [&](DataChunk&& chunk){
+    
+    appendDataChunk(chunk);
+    return true;
+    
+  });
+  
+}
+
+void ExperimentExtractor::addSimulationTrees(TTree* simu1, TTree* simu2){
+  
+  selectBranches(simu1, {"run", "runlength", "p_th", "f239Pu", "f241Pu", "f235U", "f238U"});
+  selectBranches(simu2, {"p_th", "f239Pu", "f241Pu", "f235U", "f238U"});
   
   simu1->SetBranchAddress("run", &runSimu);
   simu1->SetBranchAddress("runlength", &runLength);
-  simu1->SetBranchAddress("n_nu", &numberOfNeutrinosSimu1);
   simu1->SetBranchAddress("p_th", &power1);
   simu1->SetBranchAddress("f239Pu", &f239Pu_1);
   simu1->SetBranchAddress("f241Pu", &f241Pu_1);
   simu1->SetBranchAddress("f235U", &f235U_1);
   simu1->SetBranchAddress("f238U", &f238U_1);
 
-  simu2->SetBranchAddress("n_nu", &numberOfNeutrinosSimu2);
   simu2->SetBranchAddress("p_th", &power2);
   simu2->SetBranchAddress("f239Pu", &f239Pu_2);
   simu2->SetBranchAddress("f241Pu", &f241Pu_2);
   simu2->SetBranchAddress("f235U", &f235U_2);
   simu2->SetBranchAddress("f238U", &f238U_2);
+  
+  if(simu1->GetEntries() != simu2->GetEntries()) Tracer(Verbose::Warning)<<"The simulation trees have "<<simu1->GetEntries()<<" and "<<simu2->GetEntries()<<" entries => Extra entries ignored"<<std::endl;
+  
+  const double* noEnergy = nullptr;
+  for(Long64_t k = 0; k < std::min(simu1->GetEntries(), simu2->GetEntries()); ++k){
+    
+    simu1->GetEntry(k);
+    simu2->GetEntry(k);
+    
+    constants::adaptUnits(runLength, power1, power2);
+    simulatedRuns.addRun(runSimu, runLength, power1, power2, {f235U_1, f238U_1, f239Pu_1, f241Pu_1}, {f235U_2, f238U_2, f239Pu_2, f241Pu_2}, noEnergy, noEnergy);
+    
+  }
+  
+  simu1->ResetBranchAddresses();
+  simu2->ResetBranchAddresses();
+  
+}
 
+bool ExperimentExtractor::addDataFile(const std::string& path, const char* treeName){
+  
+  TFile file(path.c_str());
+  TTree* data = file.IsZombie() ? nullptr : dynamic_cast<TTree*>(file.Get(treeName));
+  if(!data){
+    
+    Tracer(Verbose::Error)<<"Cannot read '"<<treeName<<"' from '"<<path<<"' => File ignored"<<std::endl;
+    return false;
+    
+  }
+  
+  addDataTree(data);
+  return true;//the tree is deleted with the file
+  
+}
+
+bool ExperimentExtractor::addSimulationFiles(const std::string& path1, const std::string& path2, const char* treeName){
+  
+  TFile file1(path1.c_str());
+  TFile file2(path2.c_str());
+  TTree* simu1 = file1.IsZombie() ? nullptr : dynamic_cast<TTree*>(file1.Get(treeName));
+  TTree* simu2 = file2.IsZombie() ? nullptr : dynamic_cast<TTree*>(file2.Get(treeName));
+  if(!simu1 || !simu2){
+    
+    Tracer(Verbose::Error)<<"Cannot read '"<<treeName<<"' from '"<<path1<<"' and '"<<path2<<"' => Files ignored"<<std::endl;
+    return false;
+    
+  }
+  
+  addSimulationTrees(simu1, simu2);
+  return true;
+  
+}
+
+bool ExperimentExtractor::addDataFiles(const std::vector<std::string>& paths, unsigned queueDepth, const char* treeName){
+  
+  BoundedQueue<DataChunk> queue(queueDepth);
+  std::exception_ptr readingError;
+  bool allRead = true;//only written by the reader
+  
+  std::thread reader([&](){//only this thread uses ROOT until it is joined
+    
+    try{
+      
+      for(const auto& path : paths){
+        
+        TFile file(path.c_str());
+        TTree* data = file.IsZombie() ? nullptr : dynamic_cast<TTree*>(file.Get(treeName));
+        if(!data){
+          
+          Tracer(Verbose::Error)<<"Cannot read '"<<treeName<<"' from '"<<path<<"' => File ignored"<<std::endl;
+          allRead = false;
+          continue;
+          
+        }
+        
+        bool open = true;
+        readDataChunks<DataChunk>(data, [&](DataChunk&& chunk){return open = queue.push(std::move(chunk));});
+        if(!open) break;//the consumer has stopped
+        
+      }
+      
+    }
+    catch(...){
+      
+      readingError = std::current_exception();
+      
+    }
+    
+    queue.close();
+    
+  });
+  
+  try{
+    
+    DataChunk chunk;
+    while(queue.pop(chunk)) appendDataChunk(chunk);//overlaps with the reading of the next chunks
+    
+  }
+  catch(...){
+    
+    queue.close();//unblock the reader before waiting for it
+    reader.join();
+    throw;
+    
+  }
+  
+  reader.join();
+  if(readingError) std::rethrow_exception(readingError);
+  
+  return allRead;
+  
+}
+
+RunTable ExperimentExtractor::extractRunTable(){
+  
+  RunTable runTable;
+  std::unordered_set<int> simulatedRunNumbers;
+  const std::vector<double> noEnergies;
+  
+  for(unsigned k = 0; k < simulatedRuns.getNumberOfRuns(); ++k){
+    
+    int runNumber = simulatedRuns.getRunNumber(k);
+    if(!simulatedRunNumbers.insert(runNumber).second){
+      
+      Tracer(Verbose::Warning)<<"Run "<<runNumber<<" appears several times in the simulation trees => Run only added once"<<std::endl;
+      continue;
+      
+    }
+    
+    auto itRun = energiesData.find(runNumber);
+    const auto& energies = itRun != energiesData.end() ? itRun->second : noEnergies;//already sorted, so the Runs are built without sorting
+    runTable.addRun(runNumber, simulatedRuns.getRunLength(k), simulatedRuns.getPower1(k), simulatedRuns.getPower2(k), simulatedRuns.getFissions1(k), simulatedRuns.getFissions2(k), energies.begin(), energies.end());
+    if(itRun != energiesData.end()) itRun->second = std::vector<double>();//release the run as soon as it is copied
+
+  }
+
+  unsigned numberOfLostEntries{};
+  for(const auto& pair : energiesData) if(simulatedRunNumbers.count(pair.first) == 0) numberOfLostEntries += pair.second.size();
+  if(numberOfLostEntries != 0) Tracer(Verbose::Warning)<<numberOfLostEntries<<" data entries belong to runs missing from the simulation trees => Entries not added"<<std::endl;
+
+  energiesData = std::unordered_map<int, std::vector<double>>();//release the accumulated trees
+  simulatedRuns.clear();
+
+  return runTable;
+  
 }
@@ -0,0 +1,25 @@
+#include <thread>
+#include "Parallel.hpp"
+
+namespace parallel{
+  
+  namespace{
+    
+    std::atomic<unsigned> globalNumberOfThreads{std::max(std::thread::hardware_concurrency(), 1u)};
+    
+  }
+  
+  void setNumberOfThreads(unsigned numberOfThreads){
+    
+    if(numberOfThreads == 0) numberOfThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    globalNumberOfThreads = numberOfThreads;
+    
+  }
+  
+  unsigned getNumberOfThreads(){
+    
+    return globalNumberOfThreads;
+    
+  }
+  
+}
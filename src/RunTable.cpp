@@ -0,0 +1,232 @@
+#include "RunTable.hpp"
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include "Tracer.hpp"
+
+namespace{
+
+  const char magic[8] = {'R','U','N','T','A','B','L','E'};
+  const std::uint32_t version = 2;
+
+  struct Header{
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t sizeOfInt;//to reject files written on a platform with another layout
+    std::uint64_t numberOfRuns;
+    std::uint64_t numberOfNeutrinos;
+    std::uint64_t sizeOfSources;//the description of the inputs follows the header
+
+  };
+
+  template <class T>
+  void writeColumn(std::ofstream& output, const std::vector<T>& column){
+
+    output.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+
+  }
+
+  template <class T>
+  void readColumn(std::ifstream& input, std::vector<T>& column, std::uint64_t size){
+
+    column.resize(size);
+    input.read(reinterpret_cast<char*>(column.data()), size * sizeof(T));//straight into the column, without an intermediate buffer
+
+  }
+
+}
+
+RunTable::RunTable():energyOffsets(1, 0){
+
+}
+
+void RunTable::clear(){
+
+  *this = RunTable();
+
+}
+
+unsigned RunTable::getNumberOfRuns() const{
+
+  return runNumbers.size();
+
+}
+
+std::uint64_t RunTable::getNumberOfNeutrinos() const{
+
+  return energies.size();
+
+}
+
+int RunTable::getRunNumber(unsigned k) const{
+
+  return runNumbers.at(k);
+
+}
+
+double RunTable::getRunLength(unsigned k) const{
+
+  return runLengths.at(k);
+
+}
+
+double RunTable::getPower1(unsigned k) const{
+
+  return powers1.at(k);
+
+}
+
+double RunTable::getPower2(unsigned k) const{
+
+  return powers2.at(k);
+
+}
+
+Fuel RunTable::getFuel1(unsigned k) const{
+
+  return Fuel(fissions1[0].at(k), fissions1[1].at(k), fissions1[2].at(k), fissions1[3].at(k));
+
+}
+
+Fuel RunTable::getFuel2(unsigned k) const{
+
+  return Fuel(fissions2[0].at(k), fissions2[1].at(k), fissions2[2].at(k), fissions2[3].at(k));
+
+}
+
+std::array<double, 4> RunTable::getFissions1(unsigned k) const{
+
+  return {fissions1[0].at(k), fissions1[1].at(k), fissions1[2].at(k), fissions1[3].at(k)};
+
+}
+
+std::array<double, 4> RunTable::getFissions2(unsigned k) const{
+
+  return {fissions2[0].at(k), fissions2[1].at(k), fissions2[2].at(k), fissions2[3].at(k)};
+
+}
+
+std::vector<double>::const_iterator RunTable::getFirstEnergy(unsigned k) const{
+
+  return energies.begin() + energyOffsets.at(k);
+
+}
+
+std::vector<double>::const_iterator RunTable::getLastEnergy(unsigned k) const{
+
+  return energies.begin() + energyOffsets.at(k + 1);
+
+}
+
+bool RunTable::save(const std::string& path, const std::string& sources) const{
+
+  std::ofstream output(path, std::ios::binary | std::ios::trunc);
+  if(!output){
+
+    Tracer(Verbose::Error)<<"Cannot open '"<<path<<"' => Run table not saved"<<std::endl;
+    return false;
+
+  }
+
+  Header header{};
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version = version;
+  header.sizeOfInt = sizeof(int);
+  header.numberOfRuns = getNumberOfRuns();
+  header.numberOfNeutrinos = getNumberOfNeutrinos();
+  header.sizeOfSources = sources.size();
+  output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  output.write(sources.data(), sources.size());
+
+  writeColumn(output, runNumbers);
+  writeColumn(output, runLengths);
+  writeColumn(output, powers1);
+  writeColumn(output, powers2);
+  for(const auto& column : fissions1) writeColumn(output, column);
+  for(const auto& column : fissions2) writeColumn(output, column);
+  writeColumn(output, energyOffsets);
+  writeColumn(output, energies);
+
+  if(!output){
+
+    Tracer(Verbose::Error)<<"Cannot write '"<<path<<"' => Run table not saved"<<std::endl;
+    return false;
+
+  }
+
+  return true;
+
+}
+
+bool RunTable::load(const std::string& path, const std::string& sources){
+
+  clear();
+
+  std::ifstream input(path, std::ios::binary | std::ios::ate);
+  if(!input){
+
+    Tracer(Verbose::Warning)<<"Cannot open '"<<path<<"' => Run table not loaded"<<std::endl;
+    return false;
+
+  }
+
+  std::uint64_t fileSize = input.tellg();
+  input.seekg(0);
+
+  Header header;
+  if(fileSize < sizeof(Header) || !input.read(reinterpret_cast<char*>(&header), sizeof(header))){
+
+    Tracer(Verbose::Warning)<<"'"<<path<<"' is too small to be a run table => Run table not loaded"<<std::endl;
+    return false;
+
+  }
+
+  std::uint64_t numberOfRuns = header.numberOfRuns;
+  std::uint64_t numberOfNeutrinos = header.numberOfNeutrinos;
+  std::uint64_t expectedSize = sizeof(Header) + header.sizeOfSources + numberOfRuns * (sizeof(int) + 11 * sizeof(double)) + (numberOfRuns + 1) * sizeof(std::uint64_t) + numberOfNeutrinos * sizeof(double);
+
+  bool valid = std::memcmp(header.magic, magic, sizeof(magic)) == 0 && header.version == version && header.sizeOfInt == sizeof(int);
+  if(!valid || fileSize != expectedSize){
+
+    Tracer(Verbose::Warning)<<"'"<<path<<"' is not a valid run table => Run table not loaded"<<std::endl;
+    return false;
+
+  }
+
+  std::string savedSources(header.sizeOfSources, '\0');
+  if(!input.read(&savedSources[0], savedSources.size()) || savedSources != sources){
+
+    Tracer(Verbose::Warning)<<"'"<<path<<"' was extracted from other inputs => Run table not loaded"<<std::endl;
+    return false;
+
+  }
+
+  readColumn(input, runNumbers, numberOfRuns);
+  readColumn(input, runLengths, numberOfRuns);
+  readColumn(input, powers1, numberOfRuns);
+  readColumn(input, powers2, numberOfRuns);
+  for(auto& column : fissions1) readColumn(input, column, numberOfRuns);
+  for(auto& column : fissions2) readColumn(input, column, numberOfRuns);
+  readColumn(input, energyOffsets, numberOfRuns + 1);
+  readColumn(input, energies, numberOfNeutrinos);
+
+  if(!input){
+
+    Tracer(Verbose::Warning)<<"Cannot read '"<<path<<"' => Run table not loaded"<<std::endl;
+    clear();
+    return false;
+
+  }
+
+  if(energyOffsets.front() != 0 || energyOffsets.back() != numberOfNeutrinos || !std::is_sorted(energyOffsets.begin(), energyOffsets.end())){
+
+    Tracer(Verbose::Warning)<<"'"<<path<<"' has inconsistent energy offsets => Run table not loaded"<<std::endl;
+    clear();
+    return false;
+
+  }
+
+  return true;
+
+}
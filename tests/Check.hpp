@@ -0,0 +1,33 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <iostream>
+
+//each test is an executable which records its failed checks and returns report(name)
+
+inline unsigned& numberOfFailures(){
+
+  static unsigned failures{};
+  return failures;
+
+}
+
+inline void check(bool condition, const char* description){
+
+  if(!condition){
+
+    std::cerr<<"FAILED: "<<description<<std::endl;
+    ++numberOfFailures();
+
+  }
+
+}
+
+inline int report(const char* testName){//exit code of the test
+
+  if(numberOfFailures() == 0) std::cout<<testName<<" passed"<<std::endl;
+  return numberOfFailures() == 0 ? 0 : 1;
+
+}
+
+#endif
@@ -0,0 +1,43 @@
+#include <vector>
+#include <cmath>
+#include "Constants.hpp"
+#include "Check.hpp"
+
+namespace{
+
+  bool agree(double arrayValue, double scalarValue, double tolerance){//NaN's must match as well
+
+    if(std::isnan(scalarValue)) return std::isnan(arrayValue);
+    return std::abs(arrayValue - scalarValue) <= tolerance * std::max(1., std::abs(scalarValue));
+
+  }
+
+}
+
+int main(){
+
+  std::vector<double> energies;
+  for(unsigned i = 0; i <= 20000; ++i) energies.emplace_back(0.5 + i * 1e-3);//below and above the threshold, up to 20.5 MeV
+  std::vector<double> results(energies.size());
+
+  constants::crossSection(energies.data(), results.data(), energies.size());
+  bool sameCrossSections = true;
+  for(unsigned i = 0; i < energies.size(); ++i) sameCrossSections = sameCrossSections && agree(results[i], constants::crossSection(energies[i]), 1e-14);
+  check(sameCrossSections, "array crossSection agrees with the scalar version");
+
+  const std::vector<double> distances{constants::distance::average, 1e4, 1e6, 1e10};//phases from about 1 rad to beyond the domain of the vectorised sine
+  const std::vector<double> deltas31{constants::squaredMass::delta31, 2.5e-3, 1e-2};
+  const std::vector<double> thetas13{constants::mixing::th13, 0.15, 0.785};
+  bool sameProbabilities = true;
+  for(auto distance : distances) for(auto delta31 : deltas31) for(auto th13 : thetas13){
+
+    constants::oscillation(energies.data(), results.data(), energies.size(), distance, th13, delta31);
+    for(unsigned i = 0; i < energies.size(); ++i) sameProbabilities = sameProbabilities && agree(results[i], constants::oscillation(energies[i], distance, th13, delta31), 1e-12);
+
+  }
+
+  check(sameProbabilities, "array oscillation agrees with the scalar version");
+
+  return report("ConstantsTest");
+
+}
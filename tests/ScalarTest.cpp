@@ -0,0 +1,48 @@
+#include <vector>
+#include "Scalar.hpp"
+#include "Parallel.hpp"
+#include "Check.hpp"
+
+namespace{
+
+  Scalar<double> propagate(unsigned k){//mixes correlated and independent operations, whose variances depend on the identifiers
+
+    Scalar<double> x{1. + k, 0.5 + k};
+    Scalar<double> y{2. + k, 0.25};
+    Scalar<double> sum = x + x;//fully correlated
+    Scalar<double> difference = x - y;//independent
+    Scalar<double> product = x * y;
+    Scalar<double> ratio = x / x;//no uncertainty left
+    Scalar<double> opposite = -x;
+    opposite += x;//anti-correlated with x
+    return sum * difference + product + ratio + opposite;
+
+  }
+
+}
+
+int main(){
+
+  const unsigned numberOfScalars = 20000;
+
+  std::vector<Scalar<double>> serialResults;
+  for(unsigned k = 0; k < numberOfScalars; ++k) serialResults.emplace_back(propagate(k));
+
+  parallel::setNumberOfThreads(8);
+  std::vector<Scalar<double>> parallelResults(numberOfScalars);
+  parallel::forEachIndex(numberOfScalars, [&](unsigned k){parallelResults[k] = propagate(k);});
+
+  bool sameVariances = true;
+  for(unsigned k = 0; k < numberOfScalars; ++k) sameVariances = sameVariances && parallelResults[k].getValue() == serialResults[k].getValue() && parallelResults[k].getVariance() == serialResults[k].getVariance();
+  check(sameVariances, "multithreaded arithmetic gives the variances of the serial arithmetic");
+
+  std::vector<Scalar<double>> scalars(2000);
+  parallel::forEachIndex(scalars.size(), [&](unsigned k){scalars[k] = Scalar<double>{1., 1.};});//identifiers drawn from the blocks of several threads
+  bool independent = true;
+  for(unsigned i = 0; i < scalars.size(); ++i)
+    for(unsigned j = i + 1; j < scalars.size(); ++j) independent = independent && scalars[i].getCovarianceWith(scalars[j]) == 0;
+  check(independent, "scalars created in different threads have distinct identifiers");
+
+  return report("ScalarTest");
+
+}
@@ -0,0 +1,47 @@
+#include <utility>
+#include "SmallVector.hpp"
+#include "Check.hpp"
+
+namespace{
+
+  template <unsigned N>
+  bool isEmptyAndUsable(SmallVector<double,N>& vector){//a moved-from vector must be reusable
+
+    bool empty = vector.empty() && vector.size() == 0 && vector.begin() == vector.end();
+    for(unsigned k = 0; k < N + 2; ++k) vector.emplace_back(k);
+    bool refilled = vector.size() == N + 2 && vector[N + 1] == N + 1;
+    return empty && refilled;
+
+  }
+
+}
+
+int main(){
+
+  SmallVector<double,2> inlineVector{1., 2.};
+  SmallVector<double,2> movedInline(std::move(inlineVector));
+  check(movedInline.size() == 2 && movedInline[0] == 1. && movedInline[1] == 2., "move construction from the inline state keeps the elements");
+  check(isEmptyAndUsable(inlineVector), "move construction from the inline state leaves the source empty");
+
+  SmallVector<double,2> heapVector{1., 2., 3., 4.};
+  SmallVector<double,2> movedHeap(std::move(heapVector));
+  check(movedHeap.size() == 4 && movedHeap[3] == 4., "move construction from the heap state keeps the elements");
+  check(isEmptyAndUsable(heapVector), "move construction from the heap state leaves the source empty");
+
+  SmallVector<double,2> inlineSource{5.}, heapTarget{1., 2., 3.};
+  heapTarget = std::move(inlineSource);
+  check(heapTarget.size() == 1 && heapTarget[0] == 5. && heapTarget.data() != nullptr, "move assignment from the inline state onto a heap vector keeps the element");
+  check(isEmptyAndUsable(inlineSource), "move assignment from the inline state leaves the source empty");
+
+  SmallVector<double,2> heapSource{6., 7., 8.}, inlineTarget{1.};
+  inlineTarget = std::move(heapSource);
+  check(inlineTarget.size() == 3 && inlineTarget[2] == 8., "move assignment from the heap state keeps the elements");
+  check(isEmptyAndUsable(heapSource), "move assignment from the heap state leaves the source empty");
+
+  auto& self = inlineTarget;
+  inlineTarget = std::move(self);
+  check(inlineTarget.size() == 3 && inlineTarget[0] == 6., "self move assignment keeps the elements");
+
+  return report("SmallVectorTest");
+
+}